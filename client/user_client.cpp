@@ -63,19 +63,19 @@ std::string UserClient::signUp() {
 void UserClient::sendRequest(const std::string &requestType,
                              const std::string &message) {
   nlohmann::json req;
-  req["UserId"] = myId_;
   req["ReqType"] = requestType;
   req["Message"] = message;
 
   std::string request = req.dump();
+  request.push_back(common::messageDelimiter);
   boost::asio::write(s_, boost::asio::buffer(request, request.size()));
 }
 
 std::string UserClient::receiveResponse() {
-  boost::asio::streambuf b;
-  boost::asio::read_until(s_, b, "\0");
-  std::istream is(&b);
-  std::string line(std::istreambuf_iterator<char>(is), {});
+  boost::asio::read_until(s_, response_, common::messageDelimiter);
+  std::istream is(&response_);
+  std::string line;
+  std::getline(is, line, common::messageDelimiter);
   return line;
 }
 
@@ -226,20 +226,56 @@ UserClient::convertTypeValuePairToJSON(const common::CurrencyTypeValue &pair) {
   return jsonStr.dump();
 }
 
-std::string UserClient::inputCurrencyPair() {
+common::currency::InstrumentId UserClient::inputCurrencyPair() {
   std::cout << "Input currency pair:" << std::endl;
   std::string currencyPair;
   std::cin >> currencyPair;
-  if (common::currency::currencyPairs.find(currencyPair) ==
-      common::currency::currencyPairs.end()) {
-    return "";
+  return common::currency::findInstrument(currencyPair);
+}
+
+int UserClient::inputOrderKind() {
+  std::cout << "Input order kind (" << common::OrderKind_Limit << " - Limit, "
+            << common::OrderKind_Stop << " - Stop, "
+            << common::OrderKind_StopLimit << " - Stop-limit, "
+            << common::OrderKind_Iceberg << " - Iceberg):" << std::endl;
+  std::string kind;
+  std::cin >> kind;
+  if (!isValidInt(kind) || (std::stoi(kind) > common::OrderKind_Iceberg)) {
+    return -1;
   }
-  return currencyPair;
+  return std::stoi(kind);
+}
+
+bool UserClient::inputTimeInForce(common::Order &request) {
+  std::cout << "Input time in force (" << common::TimeInForce_GTC
+            << " - GTC, " << common::TimeInForce_IOC << " - IOC, "
+            << common::TimeInForce_FOK << " - FOK, "
+            << common::TimeInForce_DAY << " - DAY, "
+            << common::TimeInForce_GTD << " - GTD):" << std::endl;
+  std::string timeInForce;
+  std::cin >> timeInForce;
+  if (!isValidInt(timeInForce) ||
+      (std::stoi(timeInForce) > common::TimeInForce_GTD)) {
+    return false;
+  }
+  request.timeInForce =
+      static_cast<common::TimeInForce>(std::stoi(timeInForce));
+  if (request.timeInForce == common::TimeInForce_GTD) {
+    std::cout << "Input lifetime (seconds):" << std::endl;
+    std::string lifetime;
+    std::cin >> lifetime;
+    if (!isValidInt(lifetime)) {
+      return false;
+    }
+    request.expireTime = common::currentTimestamp() +
+                         std::stoll(lifetime) * 1000000000ll;
+  }
+  return true;
 }
 
 void UserClient::showCurrencyTypes() {
   std::cout << "Currency types:" << std::endl;
-  for (const std::string &type : common::currency::currencyTypes) {
+  for (const std::string_view type : common::currency::currencyNames) {
     std::cout << type << std::endl;
   }
 }
@@ -248,23 +284,13 @@ std::string UserClient::inputCurrencyType() {
   std::cout << "Input currency type:" << std::endl;
   std::string currencyType;
   std::cin >> currencyType;
-  if (common::currency::currencyTypes.find(currencyType) ==
-      common::currency::currencyTypes.end()) {
+  if (common::currency::findCurrency(currencyType) ==
+      common::currency::CurrencyCount) {
     return "";
   }
   return currencyType;
 }
 
-std::pair<std::string, std::string>
-UserClient::separateCurrencyPair(const std::string &currencyPair) {
-  char sep = '-';
-  size_t i = currencyPair.find(sep);
-  std::pair<std::string, std::string> pair;
-  pair.first = currencyPair.substr(0, i);
-  pair.second = currencyPair.substr(i + 1);
-  return pair;
-}
-
 std::string UserClient::inputCurrencyValue() {
   std::cout << "Input currency value:" << std::endl;
   std::string currencyValue;
@@ -277,45 +303,79 @@ std::string UserClient::inputCurrencyValue() {
 
 std::string UserClient::createOrderRequest(const common::OrderType &orderType) {
   showCurrencyPairs();
-  std::string currencyPair = inputCurrencyPair();
-  if (currencyPair.empty()) {
+  const common::currency::InstrumentId currencyPair = inputCurrencyPair();
+  if (currencyPair == common::currency::InstrumentCount) {
     std::cout << "Wrong currency pair\n" << std::endl;
     return "";
   }
-  std::pair<std::string, std::string> separatedCurrencyPair =
-      separateCurrencyPair(currencyPair);
-  std::cout << "\nInput volume (" + separatedCurrencyPair.first + ")"
+  const int kind = inputOrderKind();
+  if (kind < 0) {
+    std::cout << "Wrong order kind\n" << std::endl;
+    return "";
+  }
+  const common::currency::Instrument &instrument =
+      common::currency::instruments[currencyPair];
+  std::cout << "\nInput volume ("
+            << common::currency::currencyNames[instrument.base] << ")"
             << std::endl;
   std::string volume = inputCurrencyValue();
   if (volume.empty()) {
     std::cout << "Wrong volume value\n" << std::endl;
     return "";
   }
-  std::cout << "\nInput price (" + separatedCurrencyPair.second + ")"
-            << std::endl;
-  std::string price = inputCurrencyValue();
-  if (price.empty()) {
-    std::cout << "Wrong price value\n" << std::endl;
+  common::Order request;
+  request.kind = static_cast<common::OrderKind>(kind);
+  if ((request.kind == common::OrderKind_Stop) ||
+      (request.kind == common::OrderKind_StopLimit)) {
+    std::cout << "\nInput stop price ("
+              << common::currency::currencyNames[instrument.quote] << ")"
+              << std::endl;
+    const std::string stopPrice = inputCurrencyValue();
+    if (stopPrice.empty()) {
+      std::cout << "Wrong stop price value\n" << std::endl;
+      return "";
+    }
+    request.stopPrice = std::stof(stopPrice);
+  }
+  // Стоп-заявка исполняется по рынку, цена не вводится.
+  std::string price = "0";
+  if (request.kind != common::OrderKind_Stop) {
+    std::cout << "\nInput price ("
+              << common::currency::currencyNames[instrument.quote] << ")"
+              << std::endl;
+    price = inputCurrencyValue();
+    if (price.empty()) {
+      std::cout << "Wrong price value\n" << std::endl;
+      return "";
+    }
+  }
+  if (request.kind == common::OrderKind_Iceberg) {
+    std::cout << "\nInput visible volume ("
+              << common::currency::currencyNames[instrument.base] << ")"
+              << std::endl;
+    const std::string peak = inputCurrencyValue();
+    if (peak.empty()) {
+      std::cout << "Wrong visible volume value\n" << std::endl;
+      return "";
+    }
+    request.peak = std::stof(peak);
+  }
+  if (!inputTimeInForce(request)) {
+    std::cout << "Wrong time in force\n" << std::endl;
     return "";
   }
-  std::time_t time =
-      std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-
-  common::Order request;
-  request.userID = myId_;
-  request.volume.first = separatedCurrencyPair.first;
-  request.volume.second = std::stof(volume);
-  request.price.first = separatedCurrencyPair.second;
-  request.price.second = std::stof(price);
+  request.instrument = currencyPair;
+  request.volume = std::stof(volume);
+  request.price = std::stof(price);
   request.type = orderType;
-  request.time = time;
   return orderRequestToJson(request);
 }
 
 void UserClient::showCurrencyPairs() {
   std::cout << "Currency pairs:" << std::endl;
-  for (const std::string &pair : common::currency::currencyPairs) {
-    std::cout << pair << std::endl;
+  for (const common::currency::Instrument &instrument :
+       common::currency::instruments) {
+    std::cout << instrument.name << std::endl;
   }
 }
 
@@ -338,14 +398,25 @@ bool UserClient::isValidInt(const std::string &str) {
 }
 
 std::string UserClient::orderRequestToJson(const common::Order &request) {
+  const common::currency::Instrument &instrument =
+      common::currency::instruments[request.instrument];
   nlohmann::json jsonStr;
-  jsonStr["volume"] = {{"currencyType", request.volume.first},
-                       {"value", request.volume.second}};
-  jsonStr["price"] = {{"currencyType", request.price.first},
-                      {"value", request.price.second}};
+  jsonStr["volume"] = {
+      {"currencyType", common::currency::currencyNames[instrument.base]},
+      {"value", request.volume}};
+  jsonStr["price"] = {
+      {"currencyType", common::currency::currencyNames[instrument.quote]},
+      {"value", request.price}};
   jsonStr["type"] = request.type;
-  jsonStr["time"] = request.time;
-  jsonStr["userID"] = request.userID;
+  if (request.kind != common::OrderKind_Limit) {
+    jsonStr["kind"] = request.kind;
+    jsonStr["stopPrice"] = request.stopPrice;
+    jsonStr["peak"] = request.peak;
+  }
+  if (request.timeInForce != common::TimeInForce_GTC) {
+    jsonStr["timeInForce"] = request.timeInForce;
+    jsonStr["expireTime"] = request.expireTime;
+  }
   return jsonStr.dump();
 }
 
@@ -354,7 +425,9 @@ void UserClient::parseOrdersMessage(const std::string &msg) {
   const std::size_t num = j["count"].get<std::size_t>();
   std::cout << "Count opened orders: " + std::to_string(num) << std::endl;
   for (size_t i = 0; i < num; ++i) {
-    std::cout << "Order №" << i + 1 << ":" << std::endl;
+    std::cout << "Order №" << i + 1 << " (id "
+              << j[std::to_string(i + 1)]["id"].get<std::uint64_t>()
+              << "):" << std::endl;
     std::cout << "Order type: "
               << (j[std::to_string(i + 1)]["type"].get<common::OrderType>() ==
                           common::OrderType_Buy
@@ -374,6 +447,17 @@ void UserClient::parseOrdersMessage(const std::string &msg) {
         << " "
         << j[std::to_string(i + 1)]["price"]["currencyType"].get<std::string>()
         << std::endl;
+    const common::OrderKind kind = j[std::to_string(i + 1)].value(
+        "kind", common::OrderKind_Limit);
+    if ((kind == common::OrderKind_Stop) ||
+        (kind == common::OrderKind_StopLimit)) {
+      std::cout << "Stop price: "
+                << j[std::to_string(i + 1)]["stopPrice"].get<float>()
+                << std::endl;
+    } else if (kind == common::OrderKind_Iceberg) {
+      std::cout << "Visible volume: "
+                << j[std::to_string(i + 1)]["peak"].get<float>() << std::endl;
+    }
     std::cout << std::endl;
   }
 }
\ No newline at end of file
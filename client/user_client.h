@@ -32,6 +32,8 @@ private:
   uint16_t port_;       //!< Порт.
   tcp::socket s_;       //!< Сокет.
   std::string myId_;    //!< ID клиента.
+  //! Принятые данные, ещё не разобранные на ответы.
+  boost::asio::streambuf response_;
 
   /**
    * @details Войти в аккаунт.
@@ -54,7 +56,7 @@ private:
 
   /**
    * @brief Получить ответ от сервера.
-   * @return Ответ от сервера.
+   * @return Ответ от сервера без разделителя.
    */
   std::string receiveResponse();
 
@@ -78,9 +80,23 @@ private:
 
   /**
    * @brief Ввести валютную пару.
-   * @return Валютная пара.
+   * @return Валютная пара или InstrumentCount, если пара неизвестна.
+   */
+  common::currency::InstrumentId inputCurrencyPair();
+
+  /**
+   * @brief Ввести вид заявки.
+   * @return Вид заявки или -1, если вид неизвестен.
+   */
+  int inputOrderKind();
+
+  /**
+   * @brief Ввести срок действия заявки.
+   * @param request Заявка, в которой задаются срок действия и время его
+   * окончания.
+   * @return true-срок введён, false-ошибка ввода.
    */
-  std::string inputCurrencyPair();
+  bool inputTimeInForce(common::Order &request);
 
   /**
    * @brief Показать доступные валюты.
@@ -99,14 +115,6 @@ private:
    */
   std::string inputCurrencyValue();
 
-  /**
-   * @brief Разделить валютную пару.
-   * @param currencyPair Валютная пара.
-   * @return Разделенная валютная пара.
-   */
-  std::pair<std::string, std::string>
-  separateCurrencyPair(const std::string &currencyPair);
-
   /**
    * @brief Валидно ли преобразование строки к float.
    * @param str Строка с значением.
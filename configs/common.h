@@ -1,22 +1,78 @@
 #pragma once
 
+// <utility> нужен Boost.Asio для сопрограмм до подключения его заголовков.
+#include <utility>
+
+#include <array>
 #include <boost/asio.hpp>
 #include <boost/bind/bind.hpp>
 #include <chrono>
+#include <cstdint>
 #include <cstdlib>
 #include <iostream>
 #include <nlohmann/json.hpp>
 #include <queue>
 #include <set>
+#include <string_view>
 
 namespace limits {
 const size_t buffSize = 1024;
-}
-
-static short port = 5555;
+//! Максимальное количество активных заявок одного пользователя.
+const size_t maxOpenOrders = 1000;
+//! Максимальная суммарная стоимость активных заявок одного пользователя.
+const float maxOpenNotional = 1e9f;
+//! Допустимая частота запросов одной сессии (запросов в секунду).
+const double sessionRequestRate = 100.;
+//! Допустимый всплеск запросов одной сессии.
+const double sessionRequestBurst = 200.;
+//! Допустимая частота запросов одного пользователя (запросов в секунду).
+const double userRequestRate = 200.;
+//! Допустимый всплеск запросов одного пользователя.
+const double userRequestBurst = 400.;
+//! Размер очереди ответов, при котором сессия перестаёт читать запросы.
+const size_t outboxHighWatermark = 256 * 1024;
+//! Размер очереди ответов, при котором сессия снова читает запросы.
+const size_t outboxLowWatermark = 64 * 1024;
+//! Размер очереди ответов, при котором медленный клиент отключается.
+const size_t maxOutboxSize = 1024 * 1024;
+//! Наибольшее количество запросов сессии, ожидающих ответа биржи.
+const size_t maxPipelinedRequests = 64;
+//! Наибольший размер запроса без разделителя.
+const size_t maxRequestSize = 64 * 1024;
+//! Размер части, которыми отправляются большие ответы.
+const size_t responseChunkSize = 16 * 1024;
+//! Размер страницы списка заявок по умолчанию.
+const size_t ordersPageSize = 100;
+//! Наибольший размер страницы списка заявок.
+const size_t maxOrdersPageSize = 1000;
+//! Количество последних сделок в ответе по умолчанию.
+const size_t tradesPageSize = 100;
+//! Наибольшее количество сделок в ответе.
+const size_t maxTradesPageSize = 1000;
+//! Наибольшее количество свечей в ответе.
+const size_t maxOhlcvBars = 10000;
+//! Допустимое отклонение цены исполнения стоп-заявки от цены срабатывания.
+const float stopPriceBand = 0.05f;
+//! Время бездействия, после которого соединение закрывается.
+const std::chrono::seconds idleTimeout(300);
+//! Период записи использования памяти в журнал.
+const std::chrono::seconds memoryReportInterval(60);
+//! Количество освобождённых блоков сессий, хранимых потоком для повторного
+//! использования.
+const size_t sessionPoolSize = 1024;
+//! Наибольшее количество событий журнала, отправляемых резервному серверу
+//! одной записью в сокет.
+const size_t replicationBatchSize = 4096;
+} // namespace limits
 
 namespace common {
 
+//! Порт сервера по умолчанию.
+constexpr unsigned short defaultPort = 5555;
+//! Разделитель сообщений протокола: им заканчивается каждый запрос и каждый
+//! ответ. JSON запросов и ответов не содержит переводов строки.
+constexpr char messageDelimiter = '\n';
+
 namespace requests {
 const std::string SignIn = "SignIn";
 const std::string SignUp = "SignUp";
@@ -27,17 +83,118 @@ const std::string Deposit = "Deposit";
 const std::string Withdraw = "Withdraw";
 const std::string Orders = "Orders";
 const std::string Cancel = "Cancel";
+const std::string Trades = "Trades";
+const std::string Ohlcv = "Ohlcv";
+const std::string Memory = "Memory";
 } // namespace requests
 
 namespace currency {
-const std::set<std::string> currencyPairs = {"RU-USD", "USD-RU"};
-const std::set<std::string> currencyTypes = {"RU", "USD"};
+
+/**
+ * @brief Идентификатор валюты.
+ */
+enum CurrencyId : std::uint8_t {
+  Currency_RU,  //!< Рубль.
+  Currency_USD, //!< Доллар.
+  CurrencyCount //!< Количество валют.
+};
+
+/**
+ * @brief Идентификатор торгового инструмента (валютной пары).
+ */
+enum InstrumentId : std::uint8_t {
+  Instrument_RU_USD, //!< Рубли за доллары.
+  Instrument_USD_RU, //!< Доллары за рубли.
+  InstrumentCount    //!< Количество инструментов.
+};
+
+/**
+ * @brief Описание торгового инструмента.
+ */
+struct Instrument {
+  InstrumentId id;       //!< Идентификатор.
+  std::string_view name; //!< Название валютной пары.
+  CurrencyId base;       //!< Покупаемая/продаваемая валюта (объём).
+  CurrencyId quote;      //!< Валюта цены.
+  float tickSize;        //!< Шаг цены.
+  int precision; //!< Количество знаков после запятой в сумме сделки.
+  //! Инструмент, в "стакане" которого исполняются заявки. Для обратной пары -
+  //! прямая пара (цена и объём пересчитываются), иначе - сам инструмент.
+  InstrumentId canonical;
+};
+
+//! Названия валют, индекс - CurrencyId.
+constexpr std::array<std::string_view, CurrencyCount> currencyNames = {"RU",
+                                                                       "USD"};
+
+//! Торговые инструменты, индекс - InstrumentId.
+constexpr std::array<Instrument, InstrumentCount> instruments = {{
+    {Instrument_RU_USD, "RU-USD", Currency_RU, Currency_USD, 0.0001f, 4,
+     Instrument_USD_RU},
+    {Instrument_USD_RU, "USD-RU", Currency_USD, Currency_RU, 0.01f, 2,
+     Instrument_USD_RU},
+}};
+
+/**
+ * @brief Найти валюту по названию.
+ * @param name Название валюты.
+ * @return Идентификатор валюты или CurrencyCount, если валюта неизвестна.
+ */
+constexpr CurrencyId findCurrency(std::string_view name) {
+  for (std::size_t i = 0; i < currencyNames.size(); ++i) {
+    if (currencyNames[i] == name) {
+      return static_cast<CurrencyId>(i);
+    }
+  }
+  return CurrencyCount;
+}
+
+/**
+ * @brief Найти инструмент по названию валютной пары.
+ * @param name Название валютной пары.
+ * @return Идентификатор инструмента или InstrumentCount, если пара неизвестна.
+ */
+constexpr InstrumentId findInstrument(std::string_view name) {
+  for (const Instrument &instrument : instruments) {
+    if (instrument.name == name) {
+      return instrument.id;
+    }
+  }
+  return InstrumentCount;
+}
+
+/**
+ * @brief Найти инструмент по валютам объёма и цены.
+ * @param base Валюта объёма.
+ * @param quote Валюта цены.
+ * @return Идентификатор инструмента или InstrumentCount, если пара неизвестна.
+ */
+constexpr InstrumentId findInstrument(CurrencyId base, CurrencyId quote) {
+  for (const Instrument &instrument : instruments) {
+    if ((instrument.base == base) && (instrument.quote == quote)) {
+      return instrument.id;
+    }
+  }
+  return InstrumentCount;
+}
+
 } // namespace currency
 
-typedef std::map<std::string, float> Balance; //<! Баланс.
-//! Пара тип валюты - значение.
+//! Баланс, индекс - CurrencyId.
+typedef std::array<float, currency::CurrencyCount> Balance;
+//! Пара тип валюты - значение (формат протокола).
 typedef std::pair<std::string, float> CurrencyTypeValue;
 
+/**
+ * @brief Получить текущее время.
+ * @return Время в наносекундах с начала эпохи.
+ */
+inline std::int64_t currentTimestamp() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
 /**
  * @brief Тип заявки.
  */
@@ -47,17 +204,54 @@ enum OrderType {
   OrderType_Sell  //!< Заявка на продажу.
 };
 
+/**
+ * @brief Вид заявки.
+ */
+enum OrderKind {
+  OrderKind_Limit,     //!< Лимитная заявка.
+  OrderKind_Stop,      //!< Стоп-заявка (исполняется по рынку).
+  OrderKind_StopLimit, //!< Стоп-лимитная заявка.
+  OrderKind_Iceberg    //!< "Айсберг": видна только часть объёма.
+};
+
+/**
+ * @brief Срок действия заявки.
+ */
+enum TimeInForce {
+  TimeInForce_GTC, //!< До отмены.
+  TimeInForce_IOC, //!< Исполнить немедленно, остаток отменить.
+  TimeInForce_FOK, //!< Исполнить немедленно целиком или отклонить.
+  TimeInForce_DAY, //!< До конца текущих суток (UTC).
+  TimeInForce_GTD  //!< До заданного времени.
+};
+
+//! ID пользователя, который не вошёл в систему.
+constexpr std::size_t unknownUser = SIZE_MAX;
+
 /**
  * @brief Заявка.
  */
 struct Order {
-  std::string userID = ""; //!< ID пользователя.
-  //! Объём заявки (сколько необходимо купить валюты).
-  CurrencyTypeValue volume = CurrencyTypeValue("", 0.f);
-  //! Цена покупаемой валюты.
-  CurrencyTypeValue price = CurrencyTypeValue("", 0.f);
+  std::size_t userID = unknownUser; //!< ID пользователя.
+  //! Торговый инструмент.
+  currency::InstrumentId instrument = currency::InstrumentCount;
+  //! Объём заявки в базовой валюте инструмента.
+  float volume = 0.f;
+  //! Цена единицы базовой валюты в валюте цены инструмента.
+  float price = 0.f;
   OrderType type = OrderType_None; //!< Тип заявки.
-  std::time_t time = 0; //!< Время регистрации заявки.
+  OrderKind kind = OrderKind_Limit; //!< Вид заявки.
+  //! Цена сделки, при достижении которой срабатывает стоп-заявка.
+  float stopPrice = 0.f;
+  //! Видимая часть объёма заявки "айсберг".
+  float peak = 0.f;
+  TimeInForce timeInForce = TimeInForce_GTC; //!< Срок действия заявки.
+  //! Время окончания действия заявки GTD (нс с начала эпохи).
+  std::int64_t expireTime = 0;
+  //! Порядковый номер заявки, присвоенный биржей (определяет приоритет).
+  std::uint64_t id = 0;
+  //! Время регистрации заявки на бирже (нс с начала эпохи).
+  std::int64_t timestamp = 0;
 };
 
 } // namespace common
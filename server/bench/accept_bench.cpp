@@ -0,0 +1,124 @@
+#include "io_threads.h"
+#include "trading_exchange_server.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+//! Запрос, на который сессия отвечает в своём потоке, не обращаясь к бирже.
+const std::string probeRequest =
+    R"({"UserId":"","ReqType":"Trades",)"
+    R"("Message":"{\"instrument\":\"USD-RU\"}"})"
+    "\n";
+
+/**
+ * @brief Подключиться к серверу и дождаться ответа сессии.
+ * @param io_service Сервис для сокета клиента.
+ * @param endpoint Адрес сервера.
+ * @details Ответ на запрос означает, что подключение принято и сессия
+ * запущена. Сокет закрывается сбросом, чтобы клиентские порты не оставались
+ * в TIME_WAIT.
+ */
+void connectOnce(boost::asio::io_service &io_service,
+                 const tcp::endpoint &endpoint) {
+  tcp::socket socket(io_service);
+  socket.connect(endpoint);
+  socket.set_option(tcp::no_delay(true));
+  boost::asio::write(socket, boost::asio::buffer(probeRequest));
+  char reply[limits::buffSize];
+  socket.read_some(boost::asio::buffer(reply));
+  socket.set_option(boost::asio::socket_base::linger(true, 0));
+  socket.close();
+}
+
+/**
+ * @brief Получить задержку по перцентилю.
+ * @param latencies Отсортированные задержки.
+ * @param percentile Перцентиль (0-100).
+ * @return Задержка в нс.
+ */
+std::int64_t percentile(const std::vector<std::int64_t> &latencies,
+                        double percentile) {
+  if (latencies.empty()) {
+    return 0;
+  }
+  const std::size_t index = static_cast<std::size_t>(
+      percentile / 100. * static_cast<double>(latencies.size() - 1));
+  return latencies[index];
+}
+
+} // namespace
+
+/**
+ * @brief Измерить скорость приёма подключений сервером.
+ * @details Аргументы: количество подключений (по умолчанию 20000),
+ * количество потоков ввода-вывода сервера (1), количество клиентских потоков
+ * (4), порт (5599). Сервер запускается в том же процессе. Каждый клиентский
+ * поток по очереди подключается, отправляет запрос ленты сделок, получает
+ * ответ и закрывает соединение. Выводит количество принятых подключений в
+ * секунду и задержку от начала подключения до ответа.
+ */
+int main(int argc, char *argv[]) {
+  try {
+    const std::size_t connections = argc > 1 ? std::stoul(argv[1]) : 20000;
+    ServerConfig config;
+    config.ioThreads = argc > 2 ? std::stoul(argv[2]) : 1;
+    const std::size_t clients = argc > 3 ? std::stoul(argv[3]) : 4;
+    config.port =
+        static_cast<unsigned short>(argc > 4 ? std::stoi(argv[4]) : 5599);
+
+    EngineThread engine;
+    engine.start(-1, WaitStrategy_Block);
+    IoThreads ioThreads(config.ioThreads);
+    ioThreads.start(-1, WaitStrategy_Block);
+    TradingExchangeServer server(ioThreads.getContexts(), engine, config);
+
+    const tcp::endpoint endpoint(boost::asio::ip::make_address("127.0.0.1"),
+                                 config.port);
+    std::atomic<std::size_t> next = 0;
+    std::vector<std::vector<std::int64_t>> latencies(clients);
+    std::vector<std::thread> threads;
+    const auto start = std::chrono::steady_clock::now();
+    for (std::size_t client = 0; client < clients; ++client) {
+      threads.emplace_back([&, client]() {
+        boost::asio::io_service io_service;
+        while (next++ < connections) {
+          const auto connectStart = std::chrono::steady_clock::now();
+          connectOnce(io_service, endpoint);
+          latencies[client].push_back(
+              std::chrono::duration_cast<std::chrono::nanoseconds>(
+                  std::chrono::steady_clock::now() - connectStart)
+                  .count());
+        }
+      });
+    }
+    for (std::thread &thread : threads) {
+      thread.join();
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    server.stop();
+    ioThreads.stop();
+    engine.stop();
+
+    std::vector<std::int64_t> all;
+    for (const std::vector<std::int64_t> &clientLatencies : latencies) {
+      all.insert(all.end(), clientLatencies.begin(), clientLatencies.end());
+    }
+    std::sort(all.begin(), all.end());
+    std::cout << "Accepted " << all.size() << " connections in "
+              << config.ioThreads << " I/O threads from " << clients
+              << " clients: " << elapsed.count() << " s, "
+              << static_cast<double>(all.size()) / elapsed.count()
+              << " accepts/s" << std::endl;
+    std::cout << "Connect to reply (ns): p50 " << percentile(all, 50.)
+              << ", p99 " << percentile(all, 99.) << ", p99.9 "
+              << percentile(all, 99.9) << ", max " << percentile(all, 100.)
+              << std::endl;
+  } catch (std::exception &e) {
+    std::cerr << "Benchmark failed: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
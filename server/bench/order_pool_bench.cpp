@@ -0,0 +1,196 @@
+#include "global_memory_accounting.h"
+#include "trading_exchange_client.h"
+
+#include <fstream>
+#include <set>
+#include <unistd.h>
+
+namespace {
+
+//! Количество заявок одного пользователя (ограничено лимитом риска).
+constexpr std::size_t ordersPerUser = limits::maxOpenOrders;
+//! Количество уровней цены в "стакане".
+constexpr std::size_t priceLevels = 1000;
+//! Допустимая резидентная память на заявку: запись пула и доля индексов
+//! уровней цены.
+constexpr double maxBytesPerOrder = 72.;
+
+/**
+ * @brief Получить объём резидентной памяти процесса.
+ * @return Объём в байтах.
+ */
+std::size_t residentBytes() {
+  std::ifstream statm("/proc/self/statm");
+  std::size_t size = 0;
+  std::size_t resident = 0;
+  statm >> size >> resident;
+  return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+}
+
+/**
+ * @brief Заявка в прежнем представлении common::Order: копия в "стакане" и
+ * у пользователя, три строки на копию.
+ */
+struct LegacyOrder {
+  std::string userID; //!< ID пользователя.
+  //! Объём заявки (сколько необходимо купить валюты).
+  std::pair<std::string, float> volume;
+  std::pair<std::string, float> price; //!< Цена покупаемой валюты.
+  common::OrderType type = common::OrderType_Buy; //!< Тип заявки.
+  std::time_t time = 0; //!< Время регистрации заявки.
+};
+
+/**
+ * @brief Порядок заявок на покупку: по убыванию цены, затем по времени.
+ */
+struct CompareLegacyBuy {
+  bool operator()(const LegacyOrder &lhs, const LegacyOrder &rhs) const {
+    return (lhs.price.second > rhs.price.second) ||
+           ((lhs.price.second == rhs.price.second) && (lhs.time < rhs.time));
+  }
+};
+
+/**
+ * @brief Порядок заявок пользователя: по времени.
+ */
+struct CompareLegacyTime {
+  bool operator()(const LegacyOrder &lhs, const LegacyOrder &rhs) const {
+    return lhs.time < rhs.time;
+  }
+};
+
+//! Множество прежних заявок, память учитывается за "стаканами".
+template <typename Compare>
+using LegacySet =
+    std::set<LegacyOrder, Compare,
+             TrackingAllocator<LegacyOrder, MemorySubsystem_Books>>;
+
+/**
+ * @brief Цена заявки с заданным номером.
+ * @param i Номер заявки.
+ * @return Цена на шаге цены инструмента USD-RU.
+ */
+float priceOf(std::size_t i) {
+  return static_cast<float>(100 + i % priceLevels) / 100.f;
+}
+
+/**
+ * @brief Выставить заявки в биржу и измерить память.
+ * @param count Количество заявок.
+ * @return Учтённая и резидентная память на заявку (байт).
+ */
+std::pair<double, double> measurePool(std::size_t count) {
+  const std::size_t rssBefore = residentBytes();
+  const MemoryAccounting::Usage booksBefore =
+      GlobalMemoryAccounting().getUsage(MemorySubsystem_Books);
+  const MemoryAccounting::Usage usersBefore =
+      GlobalMemoryAccounting().getUsage(MemorySubsystem_Users);
+
+  auto exchange = std::make_unique<TradingExchangeClient>();
+  const auto start = std::chrono::steady_clock::now();
+  std::size_t userId = common::unknownUser;
+  for (std::size_t i = 0; i < count; ++i) {
+    if (i % ordersPerUser == 0) {
+      userId = exchange->registerNewUser("user" + std::to_string(i));
+      exchange->deposit(userId, common::currency::Currency_RU, 1e6f);
+    }
+    common::Order order;
+    order.userID = userId;
+    order.instrument = common::currency::Instrument_USD_RU;
+    order.type = common::OrderType_Buy;
+    order.volume = 1.f;
+    order.price = priceOf(i);
+    order.timestamp = static_cast<std::int64_t>(i);
+    const std::string result = exchange->registerOrder(order);
+    if (result.rfind("Order registration accepted", 0) != 0) {
+      throw std::runtime_error("Order rejected: " + result);
+    }
+  }
+  const std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  const std::size_t books =
+      GlobalMemoryAccounting().getUsage(MemorySubsystem_Books).bytes -
+      booksBefore.bytes;
+  const std::size_t users =
+      GlobalMemoryAccounting().getUsage(MemorySubsystem_Users).bytes -
+      usersBefore.bytes;
+  const double perOrder = 1. / static_cast<double>(count);
+  const double accounted = static_cast<double>(books + users) * perOrder;
+  const double resident =
+      static_cast<double>(residentBytes() - rssBefore) * perOrder;
+  std::cout << "Order pool: " << count << " resting orders in "
+            << elapsed.count() << " s ("
+            << static_cast<double>(count) / elapsed.count()
+            << " orders/s)\n"
+            << "  books: " << static_cast<double>(books) * perOrder
+            << " bytes/order\n"
+            << "  users: " << static_cast<double>(users) * perOrder
+            << " bytes/order\n"
+            << "  resident: " << resident << " bytes/order" << std::endl;
+  return {accounted, resident};
+}
+
+/**
+ * @brief Сложить заявки в прежнее представление и измерить память.
+ * @param count Количество заявок.
+ * @return Учтённая память на заявку (байт).
+ */
+double measureLegacy(std::size_t count) {
+  const MemoryAccounting::Usage before =
+      GlobalMemoryAccounting().getUsage(MemorySubsystem_Books);
+  LegacySet<CompareLegacyBuy> book;
+  std::vector<LegacySet<CompareLegacyTime>> userOrders(
+      (count + ordersPerUser - 1) / ordersPerUser);
+  for (std::size_t i = 0; i < count; ++i) {
+    LegacyOrder order;
+    order.userID = std::to_string(i / ordersPerUser);
+    order.volume = {"USD", 1.f};
+    order.price = {"RU", priceOf(i)};
+    order.time = static_cast<std::time_t>(i);
+    book.insert(order);
+    userOrders[i / ordersPerUser].insert(std::move(order));
+  }
+  const double bytes = static_cast<double>(
+      GlobalMemoryAccounting().getUsage(MemorySubsystem_Books).bytes -
+      before.bytes);
+  const double perOrder = bytes / static_cast<double>(count);
+  std::cout << "Two std::set copies: " << perOrder
+            << " bytes/order (sizeof(LegacyOrder) = " << sizeof(LegacyOrder)
+            << ")" << std::endl;
+  return perOrder;
+}
+
+} // namespace
+
+/**
+ * @brief Измерить память, занимаемую заявками в "стакане".
+ * @details Аргумент - количество заявок (по умолчанию 10 миллионов). Заявки
+ * на покупку не пересекаются и остаются в "стакане". Затем те же заявки
+ * складываются в прежнее представление (два std::set с копией
+ * common::Order) для сравнения. Память "стаканов" и пользователей берётся из
+ * учёта памяти подсистем. Выводится выигрыш относительно прежнего
+ * представления; если резидентная память на заявку превышает
+ * maxBytesPerOrder, программа завершается с ошибкой.
+ */
+int main(int argc, char *argv[]) {
+  try {
+    const std::size_t count = argc > 1 ? std::stoul(argv[1]) : 10000000;
+    if (count == 0) {
+      throw std::invalid_argument("order count must be positive");
+    }
+    std::cout << "sizeof(OrderRecord) = " << sizeof(OrderRecord) << std::endl;
+    const auto [accounted, resident] = measurePool(count);
+    const double legacy = measureLegacy(count);
+    std::cout << "Reduction: " << legacy / accounted << "x" << std::endl;
+    if (resident > maxBytesPerOrder) {
+      std::cerr << "Target missed: " << resident << " bytes/order, limit "
+                << maxBytesPerOrder << std::endl;
+      return 1;
+    }
+  } catch (std::exception &e) {
+    std::cerr << "Benchmark failed: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,11 @@
+#pragma once
+
+#include "traffic_capture.h"
+
+/**
+ * @brief Глобальный объект записи трафика.
+ */
+inline TrafficCapture &GlobalTrafficCapture() {
+  static TrafficCapture trafficCapture;
+  return trafficCapture;
+}
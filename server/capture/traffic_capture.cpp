@@ -0,0 +1,94 @@
+#include "traffic_capture.h"
+
+#include <cstring>
+
+namespace {
+//! Заголовок файла захвата.
+const char captureMagic[8] = {'T', 'X', 'C', 'A', 'P', '0', '0', '1'};
+} // namespace
+
+namespace capture {
+
+void appendRecord(std::string &out, RecordKind kind, std::uint32_t session,
+                  std::int64_t timestamp, const char *data,
+                  std::uint32_t size) {
+  out.append(reinterpret_cast<const char *>(&timestamp), sizeof(timestamp));
+  out.append(reinterpret_cast<const char *>(&session), sizeof(session));
+  out.append(reinterpret_cast<const char *>(&kind), sizeof(kind));
+  out.append(reinterpret_cast<const char *>(&size), sizeof(size));
+  if (size > 0) {
+    out.append(data, size);
+  }
+}
+
+std::size_t parseRecord(const char *data, std::size_t size, Record &record) {
+  if (size < recordHeaderSize) {
+    return 0;
+  }
+  std::uint32_t payloadSize = 0;
+  std::memcpy(&record.timestamp, data, sizeof(record.timestamp));
+  std::memcpy(&record.session, data + 8, sizeof(record.session));
+  std::memcpy(&record.kind, data + 12, sizeof(record.kind));
+  std::memcpy(&payloadSize, data + 13, sizeof(payloadSize));
+  if (size < recordHeaderSize + payloadSize) {
+    return 0;
+  }
+  record.payload.assign(data + recordHeaderSize, payloadSize);
+  return recordHeaderSize + payloadSize;
+}
+
+} // namespace capture
+
+bool TrafficCapture::open(const std::string &path) {
+  file_.open(path, std::ios::binary | std::ios::trunc);
+  if (!file_.is_open()) {
+    return false;
+  }
+  file_.write(captureMagic, sizeof(captureMagic));
+  return file_.good();
+}
+
+void TrafficCapture::write(capture::RecordKind kind, std::uint32_t session,
+                           std::int64_t timestamp, const char *data,
+                           std::uint32_t size) {
+  if (!file_.is_open()) {
+    return;
+  }
+  buffer_.clear();
+  capture::appendRecord(buffer_, kind, session, timestamp, data, size);
+  file_.write(buffer_.data(), buffer_.size());
+}
+
+void TrafficCapture::flush() {
+  if (file_.is_open()) {
+    file_.flush();
+  }
+}
+
+void TrafficCapture::close() {
+  if (file_.is_open()) {
+    file_.close();
+  }
+}
+
+bool TrafficReader::open(const std::string &path) {
+  file_.open(path, std::ios::binary);
+  char magic[sizeof(captureMagic)];
+  return file_.read(magic, sizeof(magic)) &&
+         std::equal(magic, magic + sizeof(magic), captureMagic);
+}
+
+bool TrafficReader::read(capture::Record &record) {
+  std::uint32_t size = 0;
+  if (!file_.read(reinterpret_cast<char *>(&record.timestamp),
+                  sizeof(record.timestamp)) ||
+      !file_.read(reinterpret_cast<char *>(&record.session),
+                  sizeof(record.session)) ||
+      !file_.read(reinterpret_cast<char *>(&record.kind),
+                  sizeof(record.kind)) ||
+      !file_.read(reinterpret_cast<char *>(&size), sizeof(size))) {
+    return false;
+  }
+  record.payload.resize(size);
+  return static_cast<bool>(file_.read(record.payload.data(), size));
+}
@@ -0,0 +1,125 @@
+#pragma once
+
+#include "common.h"
+
+#include <fstream>
+
+namespace capture {
+
+/**
+ * @brief Тип записи захвата трафика.
+ */
+enum RecordKind : std::uint8_t {
+  RecordKind_Request = 1,    //!< Запрос клиента.
+  RecordKind_Tick = 2,       //!< Срабатывание таймера биржи.
+  RecordKind_Disconnect = 3, //!< Закрытие сессии.
+  RecordKind_State = 4,      //!< Итоговое состояние биржи.
+  RecordKind_Snapshot = 5    //!< Снимок состояния для резервного сервера.
+};
+
+/**
+ * @brief Запись захвата трафика.
+ */
+struct Record {
+  std::int64_t timestamp = 0; //!< Время события (нс с начала эпохи).
+  std::uint32_t session = 0;  //!< Номер сессии.
+  RecordKind kind = RecordKind_Request; //!< Тип записи.
+  std::string payload;                  //!< Данные записи.
+};
+
+//! Размер заголовка записи: timestamp, session, kind, size.
+constexpr std::size_t recordHeaderSize = 17;
+
+/**
+ * @brief Добавить закодированную запись в буфер.
+ * @param out Буфер.
+ * @param kind Тип записи.
+ * @param session Номер сессии.
+ * @param timestamp Время события.
+ * @param data Данные.
+ * @param size Размер данных.
+ */
+void appendRecord(std::string &out, RecordKind kind, std::uint32_t session,
+                  std::int64_t timestamp, const char *data,
+                  std::uint32_t size);
+
+/**
+ * @brief Разобрать закодированную запись.
+ * @param data Буфер.
+ * @param size Размер буфера.
+ * @param record Запись.
+ * @return Размер разобранной записи или 0, если запись получена не полностью.
+ */
+std::size_t parseRecord(const char *data, std::size_t size, Record &record);
+
+} // namespace capture
+
+/**
+ * @brief Запись трафика в файл.
+ * @details Формат файла: заголовок "TXCAP001", далее записи из полей
+ * timestamp (8 байт), session (4 байта), kind (1 байт), size (4 байта) и
+ * size байт данных.
+ */
+class TrafficCapture {
+public:
+  /**
+   * @brief Открыть файл для записи.
+   * @param path Путь к файлу.
+   * @return true-файл открыт, false-ошибка.
+   */
+  bool open(const std::string &path);
+
+  /**
+   * @brief Открыт ли файл.
+   */
+  bool isOpen() const { return file_.is_open(); }
+
+  /**
+   * @brief Записать событие.
+   * @param kind Тип записи.
+   * @param session Номер сессии.
+   * @param timestamp Время события.
+   * @param data Данные.
+   * @param size Размер данных.
+   */
+  void write(capture::RecordKind kind, std::uint32_t session,
+             std::int64_t timestamp, const char *data = nullptr,
+             std::uint32_t size = 0);
+
+  /**
+   * @brief Сбросить буфер в файл.
+   */
+  void flush();
+
+  /**
+   * @brief Закрыть файл.
+   */
+  void close();
+
+private:
+  std::ofstream file_; //!< Файл захвата.
+  std::string buffer_; //!< Буфер кодирования записи.
+};
+
+/**
+ * @brief Чтение записанного трафика.
+ */
+class TrafficReader {
+public:
+  /**
+   * @brief Открыть файл.
+   * @param path Путь к файлу.
+   * @return true-файл открыт и имеет верный формат, false-ошибка.
+   */
+  bool open(const std::string &path);
+
+  /**
+   * @brief Прочитать следующую запись.
+   * @param record Запись.
+   * @return true-запись прочитана, false-конец файла.
+   */
+  bool read(capture::Record &record);
+
+private:
+  std::ifstream file_; //!< Файл захвата.
+};
@@ -0,0 +1,37 @@
+#include "engine_thread.h"
+
+EngineThread::EngineThread() : work_(boost::asio::make_work_guard(context_)) {}
+
+EngineThread::~EngineThread() { stop(); }
+
+boost::asio::io_context &EngineThread::getContext() { return context_; }
+
+void EngineThread::start(int cpu, WaitStrategy strategy) {
+  // Поток привязывается до запуска, чтобы память, которой он касается
+  // первым, выделялась на узле NUMA его ядра.
+  std::promise<void> started;
+  std::future<void> result = started.get_future();
+  thread_ = std::thread([this, cpu, strategy, &started]() {
+    try {
+      pinCurrentThread(cpu);
+    } catch (...) {
+      started.set_exception(std::current_exception());
+      return;
+    }
+    started.set_value();
+    runContext(context_, strategy);
+  });
+  try {
+    result.get();
+  } catch (...) {
+    thread_.join();
+    throw;
+  }
+}
+
+void EngineThread::stop() {
+  work_.reset();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include "common.h"
+#include "low_latency.h"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+
+/**
+ * @brief Поток биржи.
+ * @details Все обращения к бирже, записи трафика и журналу репликации
+ * выполняются в отдельном потоке со своим io_context. Сетевые сессии
+ * передают в него команды и ожидают ответ, не блокируя поток ввода-вывода.
+ */
+class EngineThread {
+public:
+  /**
+   * @brief Конструктор.
+   * @details Поток не запускается, до вызова start() команды выполняются в
+   * вызывающем потоке.
+   */
+  EngineThread();
+
+  /**
+   * @brief Деструктор.
+   * @details Дожидается выполнения поставленных команд и завершает поток.
+   */
+  ~EngineThread();
+
+  /**
+   * @brief Получить io_context потока биржи.
+   * @return io_context.
+   */
+  boost::asio::io_context &getContext();
+
+  /**
+   * @brief Запустить поток.
+   * @param cpu Ядро процессора потока (отрицательное - без привязки).
+   * @param strategy Способ ожидания команд.
+   */
+  void start(int cpu = -1, WaitStrategy strategy = WaitStrategy_Block);
+
+  /**
+   * @brief Завершить поток после выполнения поставленных команд.
+   */
+  void stop();
+
+  /**
+   * @brief Выполнить функцию в потоке биржи и дождаться её завершения.
+   * @param function Функция.
+   * @details Исключение функции передаётся вызывающему. Если поток не
+   * запущен или вызов сделан из него самого, функция выполняется сразу.
+   */
+  template <typename Function> void runAndWait(Function &&function) {
+    if (!thread_.joinable() ||
+        (thread_.get_id() == std::this_thread::get_id())) {
+      function();
+      return;
+    }
+    std::packaged_task<void()> task(std::forward<Function>(function));
+    std::future<void> result = task.get_future();
+    boost::asio::post(context_, [&task]() { task(); });
+    result.get();
+  }
+
+  /**
+   * @brief Асинхронно выполнить команду в потоке биржи.
+   * @tparam Result Результат команды.
+   * @param function Команда, вызывается в потоке биржи с функцией
+   * завершения. Функцию завершения можно вызвать позже, например после
+   * подтверждения события резервным сервером.
+   * @param token Способ получения результата (например,
+   * boost::asio::use_awaitable).
+   * @details Результат передаётся через исполнителя, связанного с
+   * обработчиком завершения: сопрограмма сессии продолжается в потоке
+   * ввода-вывода.
+   */
+  template <typename Result, typename Function, typename CompletionToken>
+  auto asyncExecute(Function function, CompletionToken &&token) {
+    return boost::asio::async_initiate<CompletionToken, void(Result)>(
+        [this](auto handler, Function function) {
+          using Handler = decltype(handler);
+          auto work = boost::asio::make_work_guard(
+              boost::asio::get_associated_executor(handler));
+          // Функция завершения копируется в журнал репликации, поэтому
+          // обработчик хранится в разделяемом указателе.
+          auto shared = std::make_shared<Handler>(std::move(handler));
+          boost::asio::post(context_, [shared, work, function =
+                                                      std::move(function)]() {
+            function([shared, work](Result result) {
+              boost::asio::post(
+                  work.get_executor(),
+                  [shared, result = std::move(result)]() mutable {
+                    (*shared)(std::move(result));
+                  });
+            });
+          });
+        },
+        token, std::move(function));
+  }
+
+private:
+  boost::asio::io_context context_; //!< Очередь команд потока биржи.
+  //! Не даёт потоку завершиться при пустой очереди.
+  boost::asio::executor_work_guard<boost::asio::io_context::executor_type>
+      work_;
+  std::thread thread_; //!< Поток биржи.
+};
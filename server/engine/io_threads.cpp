@@ -0,0 +1,58 @@
+#include "io_threads.h"
+
+#include <future>
+
+IoThreads::IoThreads(std::size_t count) {
+  for (std::size_t i = 0; i < count; ++i) {
+    contexts_.push_back(std::make_unique<boost::asio::io_context>());
+    work_.push_back(boost::asio::make_work_guard(*contexts_.back()));
+  }
+}
+
+IoThreads::~IoThreads() { stop(); }
+
+std::vector<boost::asio::io_context *> IoThreads::getContexts() {
+  std::vector<boost::asio::io_context *> contexts;
+  for (const std::unique_ptr<boost::asio::io_context> &context : contexts_) {
+    contexts.push_back(context.get());
+  }
+  return contexts;
+}
+
+void IoThreads::start(int firstCpu, WaitStrategy strategy) {
+  for (std::size_t i = 0; i < contexts_.size(); ++i) {
+    const int cpu = firstCpu < 0 ? -1 : firstCpu + static_cast<int>(i);
+    boost::asio::io_context &context = *contexts_[i];
+    std::promise<void> started;
+    std::future<void> result = started.get_future();
+    threads_.emplace_back([&context, cpu, strategy, &started]() {
+      try {
+        pinCurrentThread(cpu);
+      } catch (...) {
+        started.set_exception(std::current_exception());
+        return;
+      }
+      started.set_value();
+      runContext(context, strategy);
+    });
+    try {
+      result.get();
+    } catch (...) {
+      stop();
+      throw;
+    }
+  }
+}
+
+void IoThreads::stop() {
+  work_.clear();
+  for (const std::unique_ptr<boost::asio::io_context> &context : contexts_) {
+    context->stop();
+  }
+  for (std::thread &thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+  threads_.clear();
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "common.h"
+#include "low_latency.h"
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Дополнительные потоки ввода-вывода.
+ * @details Каждый поток выполняет собственный io_context. Сессии, принятые
+ * потоком, работают только в нём, поэтому потоки ввода-вывода не делят
+ * состояние сессий и не синхронизируются между собой.
+ */
+class IoThreads {
+public:
+  /**
+   * @brief Конструктор.
+   * @param count Количество потоков.
+   * @details Потоки не запускаются до вызова start().
+   */
+  explicit IoThreads(std::size_t count);
+
+  /**
+   * @brief Деструктор.
+   * @details Останавливает потоки.
+   */
+  ~IoThreads();
+
+  /**
+   * @brief Получить io_context потоков.
+   * @return io_context потоков по порядку.
+   */
+  std::vector<boost::asio::io_context *> getContexts();
+
+  /**
+   * @brief Запустить потоки.
+   * @param firstCpu Ядро процессора первого потока, остальные привязываются
+   * к следующим ядрам по порядку (отрицательное - без привязки).
+   * @param strategy Способ ожидания событий.
+   */
+  void start(int firstCpu, WaitStrategy strategy);
+
+  /**
+   * @brief Остановить потоки, не дожидаясь выполнения обработчиков.
+   */
+  void stop();
+
+private:
+  //! Очереди событий потоков.
+  std::vector<std::unique_ptr<boost::asio::io_context>> contexts_;
+  //! Не дают потокам завершиться, пока в их io_context нет работы.
+  std::vector<
+      boost::asio::executor_work_guard<boost::asio::io_context::executor_type>>
+      work_;
+  std::vector<std::thread> threads_; //!< Потоки.
+};
@@ -0,0 +1,52 @@
+#include "low_latency.h"
+
+#include <cerrno>
+#include <cstring>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+void pinCurrentThread(int cpu) {
+  if (cpu < 0) {
+    return;
+  }
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  const int error = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  if (error != 0) {
+    throw std::runtime_error("Cannot pin thread to CPU " + std::to_string(cpu) +
+                             ": " + std::strerror(error));
+  }
+}
+
+void lockMemory() {
+  if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0) {
+    throw std::runtime_error(std::string("Cannot lock memory: ") +
+                             std::strerror(errno));
+  }
+}
+
+void runContext(boost::asio::io_context &context, WaitStrategy strategy) {
+  if (strategy == WaitStrategy_Block) {
+    context.run();
+    return;
+  }
+  // poll() останавливает io_context, когда работы больше нет.
+  while (!context.stopped()) {
+    if (context.poll() != 0) {
+      continue;
+    }
+    if (strategy == WaitStrategy_Yield) {
+      std::this_thread::yield();
+    } else {
+#if defined(__x86_64__) || defined(__i386__)
+      _mm_pause();
+#endif
+    }
+  }
+}
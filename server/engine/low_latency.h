@@ -0,0 +1,37 @@
+#pragma once
+
+#include "common.h"
+
+/**
+ * @brief Способ ожидания событий потоком.
+ */
+enum WaitStrategy {
+  WaitStrategy_Block, //!< Блокироваться до появления событий.
+  WaitStrategy_Yield, //!< Опрашивать очередь, уступая процессор.
+  WaitStrategy_Spin   //!< Непрерывно опрашивать очередь.
+};
+
+/**
+ * @brief Привязать текущий поток к ядру процессора.
+ * @param cpu Номер ядра (отрицательный - не привязывать).
+ * @details Бросает std::runtime_error, если привязать поток не удалось.
+ */
+void pinCurrentThread(int cpu);
+
+/**
+ * @brief Закрепить память процесса в оперативной памяти.
+ * @details Текущие и будущие страницы процесса отображаются сразу и не
+ * выгружаются (mlockall), поэтому в работе нет отказов страниц. Бросает
+ * std::runtime_error, если закрепить память не удалось (например, не
+ * хватает RLIMIT_MEMLOCK).
+ */
+void lockMemory();
+
+/**
+ * @brief Выполнять обработчики io_context до его остановки.
+ * @param context io_context.
+ * @param strategy Способ ожидания событий.
+ * @details При опросе поток не засыпает в системном вызове и сразу
+ * обрабатывает пришедшие данные ценой постоянной загрузки ядра.
+ */
+void runContext(boost::asio::io_context &context, WaitStrategy strategy);
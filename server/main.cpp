@@ -1,14 +1,88 @@
+#include "global_replication_publisher.h"
+#include "global_trading_exchange_client.h"
+#include "io_threads.h"
+#include "replica_client.h"
 #include "trading_exchange_server.h"
 
-int main() {
+int main(int argc, char *argv[]) {
   try {
+    const ServerConfig config = parseServerConfig(argc, argv);
+    if (config.lockMemory) {
+      // До запуска потоков: их стеки и вся дальнейшая память закрепляются.
+      lockMemory();
+    }
+    // Биржа работает в отдельном потоке, сессии - в основном и
+    // дополнительных потоках ввода-вывода.
+    EngineThread engine;
     boost::asio::io_service io_service;
-    TradingExchangeServer s(io_service);
+    IoThreads ioThreads(config.ioThreads - 1);
+    std::vector<boost::asio::io_context *> ioContexts = {&io_service};
+    for (boost::asio::io_context *context : ioThreads.getContexts()) {
+      ioContexts.push_back(context);
+    }
+    if (config.replicationPort != 0) {
+      GlobalReplicationPublisher().enableJournal(config.waitForReplicaAck);
+    }
+    engine.start(config.engineCpu, config.waitStrategy);
+    if (config.orderPoolSize != 0) {
+      engine.runAndWait([&config]() {
+        GlobalTradingExchangeClient().reserveOrders(config.orderPoolSize,
+                                                    config.hugePages);
+      });
+    }
 
-    io_service.run();
+    std::unique_ptr<TradingExchangeServer> s;
+    std::unique_ptr<ReplicaClient> replica;
+    if (config.primaryAddress.empty()) {
+      s = std::make_unique<TradingExchangeServer>(ioContexts, engine, config);
+    } else {
+      // Резервный сервер применяет события в потоке биржи, приём
+      // подключений после перехода в роль основного запускается в основном.
+      engine.runAndWait([&]() {
+        replica = std::make_unique<ReplicaClient>(
+            engine.getContext(), config.primaryAddress, config.primaryPort,
+            [&]() {
+              boost::asio::post(io_service, [&]() {
+                s = std::make_unique<TradingExchangeServer>(ioContexts,
+                                                            engine, config);
+              });
+            });
+      });
+    }
+
+    // SIGUSR1 переводит резервный сервер в роль основного.
+    boost::asio::signal_set signals(io_service, SIGINT, SIGTERM, SIGUSR1);
+    std::function<void(const boost::system::error_code &, int)> onSignal =
+        [&](const boost::system::error_code &error, int signal) {
+          if (error) {
+            return;
+          }
+          if ((signal == SIGUSR1) && replica) {
+            boost::asio::post(engine.getContext(),
+                              [&replica]() { replica->promote(); });
+            signals.async_wait(onSignal);
+            return;
+          }
+          if (s) {
+            s->stop();
+          }
+          if (replica) {
+            engine.runAndWait([&replica]() { replica->stop(); });
+          }
+          ioThreads.stop();
+          io_service.stop();
+        };
+    signals.async_wait(onSignal);
+
+    ioThreads.start(config.ioCpu < 0 ? -1 : config.ioCpu + 1,
+                    config.waitStrategy);
+    pinCurrentThread(config.ioCpu);
+    runContext(io_service, config.waitStrategy);
+    ioThreads.stop();
+    engine.stop();
   } catch (std::exception &e) {
     std::cerr << "Server exception: " << e.what() << "\n";
   }
 
   return 0;
-}
\ No newline at end of file
+}
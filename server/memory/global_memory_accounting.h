@@ -0,0 +1,11 @@
+#pragma once
+
+#include "memory_accounting.h"
+
+/**
+ * @brief Глобальный объект учёта памяти.
+ */
+inline MemoryAccounting &GlobalMemoryAccounting() {
+  static MemoryAccounting memoryAccounting;
+  return memoryAccounting;
+}
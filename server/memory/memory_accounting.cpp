@@ -0,0 +1,67 @@
+#include "memory_accounting.h"
+#include "json_writer.h"
+
+#include <sstream>
+
+void MemoryAccounting::allocated(MemorySubsystem subsystem,
+                                 std::size_t bytes) {
+  Counters &counters = counters_[subsystem];
+  const std::size_t total =
+      counters.bytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+  counters.blocks.fetch_add(1, std::memory_order_relaxed);
+  std::size_t peak = counters.peakBytes.load(std::memory_order_relaxed);
+  while ((peak < total) && !counters.peakBytes.compare_exchange_weak(
+                               peak, total, std::memory_order_relaxed)) {
+  }
+}
+
+void MemoryAccounting::released(MemorySubsystem subsystem, std::size_t bytes) {
+  Counters &counters = counters_[subsystem];
+  counters.bytes.fetch_sub(bytes, std::memory_order_relaxed);
+  counters.blocks.fetch_sub(1, std::memory_order_relaxed);
+}
+
+MemoryAccounting::Usage
+MemoryAccounting::getUsage(MemorySubsystem subsystem) const {
+  const Counters &counters = counters_[subsystem];
+  Usage usage;
+  usage.bytes = counters.bytes.load(std::memory_order_relaxed);
+  usage.blocks = counters.blocks.load(std::memory_order_relaxed);
+  usage.peakBytes = counters.peakBytes.load(std::memory_order_relaxed);
+  return usage;
+}
+
+std::string MemoryAccounting::report() const {
+  std::string report;
+  JsonWriter writer(report);
+  writer.beginObject();
+  for (std::size_t subsystem = 0; subsystem < MemorySubsystemCount;
+       ++subsystem) {
+    const Usage usage = getUsage(static_cast<MemorySubsystem>(subsystem));
+    writer.key(memorySubsystemNames[subsystem])
+        .beginObject()
+        .key("bytes")
+        .integer(usage.bytes)
+        .key("blocks")
+        .integer(usage.blocks)
+        .key("peakBytes")
+        .integer(usage.peakBytes)
+        .endObject();
+  }
+  writer.endObject();
+  return report;
+}
+
+std::string MemoryAccounting::summary() const {
+  std::ostringstream summary;
+  summary << "Memory:";
+  for (std::size_t subsystem = 0; subsystem < MemorySubsystemCount;
+       ++subsystem) {
+    const Usage usage = getUsage(static_cast<MemorySubsystem>(subsystem));
+    summary << (subsystem == 0 ? " " : ", ")
+            << memorySubsystemNames[subsystem] << " " << usage.bytes / 1024
+            << " KiB in " << usage.blocks << " blocks (peak "
+            << usage.peakBytes / 1024 << " KiB)";
+  }
+  return summary.str();
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include "common.h"
+
+#include <atomic>
+
+/**
+ * @brief Подсистема, за которой учитывается память.
+ */
+enum MemorySubsystem {
+  MemorySubsystem_Books,         //!< "Стаканы" и записи заявок.
+  MemorySubsystem_Users,         //!< Пользователи и их данные для ответов.
+  MemorySubsystem_Sessions,      //!< Сессии и очереди ответов.
+  MemorySubsystem_Serialization, //!< Буферы разбора запросов.
+  MemorySubsystem_Replication,   //!< Журнал событий для резервных серверов.
+  MemorySubsystemCount           //!< Количество подсистем.
+};
+
+//! Названия подсистем, индекс - MemorySubsystem.
+constexpr std::array<std::string_view, MemorySubsystemCount>
+    memorySubsystemNames = {"books", "users", "sessions", "serialization",
+                            "replication"};
+
+/**
+ * @brief Учёт памяти по подсистемам.
+ * @details Хранит занятый объём, количество выделенных блоков и наибольший
+ * занятый объём каждой подсистемы. Счётчики атомарные: память выделяется как
+ * в потоке биржи, так и в потоке ввода-вывода.
+ */
+class MemoryAccounting {
+public:
+  /**
+   * @brief Использование памяти подсистемой.
+   */
+  struct Usage {
+    std::size_t bytes = 0;     //!< Занятый объём.
+    std::size_t blocks = 0;    //!< Количество выделенных блоков.
+    std::size_t peakBytes = 0; //!< Наибольший занятый объём.
+  };
+
+  /**
+   * @brief Учесть выделение памяти.
+   * @param subsystem Подсистема.
+   * @param bytes Размер блока.
+   */
+  void allocated(MemorySubsystem subsystem, std::size_t bytes);
+
+  /**
+   * @brief Учесть освобождение памяти.
+   * @param subsystem Подсистема.
+   * @param bytes Размер блока.
+   */
+  void released(MemorySubsystem subsystem, std::size_t bytes);
+
+  /**
+   * @brief Получить использование памяти подсистемой.
+   * @param subsystem Подсистема.
+   * @return Использование памяти.
+   */
+  Usage getUsage(MemorySubsystem subsystem) const;
+
+  /**
+   * @brief Получить отчёт об использовании памяти в JSON.
+   * @return Отчёт: для каждой подсистемы bytes, blocks, peakBytes.
+   */
+  std::string report() const;
+
+  /**
+   * @brief Получить краткий отчёт для журнала.
+   * @return Строка отчёта.
+   */
+  std::string summary() const;
+
+private:
+  /**
+   * @brief Счётчики подсистемы.
+   * @details Занимают отдельную строку кэша: подсистемы обновляются из
+   * разных потоков, и общая строка передавалась бы между ядрами при каждом
+   * выделении памяти.
+   */
+  struct alignas(64) Counters {
+    std::atomic<std::size_t> bytes{0};     //!< Занятый объём.
+    std::atomic<std::size_t> blocks{0};    //!< Количество блоков.
+    std::atomic<std::size_t> peakBytes{0}; //!< Наибольший занятый объём.
+  };
+
+  //! Счётчики, индекс - MemorySubsystem.
+  std::array<Counters, MemorySubsystemCount> counters_;
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include "global_memory_accounting.h"
+
+#include <memory>
+
+/**
+ * @brief Распределитель памяти, учитывающий выделения подсистемы.
+ * @tparam T Тип элементов.
+ * @tparam Subsystem Подсистема, к которой относится память.
+ * @details Выделяет память стандартным распределителем и учитывает каждый
+ * блок в глобальном учёте памяти. Подходит для стандартных контейнеров и
+ * std::allocate_shared.
+ */
+template <typename T, MemorySubsystem Subsystem> class TrackingAllocator {
+public:
+  using value_type = T; //!< Тип элементов.
+
+  /**
+   * @brief Тот же распределитель для другого типа элементов.
+   */
+  template <typename U> struct rebind {
+    using other = TrackingAllocator<U, Subsystem>; //!< Распределитель.
+  };
+
+  TrackingAllocator() = default;
+
+  /**
+   * @brief Конструктор из распределителя другого типа элементов.
+   */
+  template <typename U>
+  TrackingAllocator(const TrackingAllocator<U, Subsystem> &) {}
+
+  /**
+   * @brief Выделить память.
+   * @param count Количество элементов.
+   * @return Память.
+   */
+  T *allocate(std::size_t count) {
+    T *memory = std::allocator<T>().allocate(count);
+    GlobalMemoryAccounting().allocated(Subsystem, count * sizeof(T));
+    return memory;
+  }
+
+  /**
+   * @brief Освободить память.
+   * @param memory Память.
+   * @param count Количество элементов.
+   */
+  void deallocate(T *memory, std::size_t count) {
+    GlobalMemoryAccounting().released(Subsystem, count * sizeof(T));
+    std::allocator<T>().deallocate(memory, count);
+  }
+
+  /**
+   * @brief Распределители без состояния взаимозаменяемы.
+   */
+  template <typename U>
+  bool operator==(const TrackingAllocator<U, Subsystem> &) const {
+    return true;
+  }
+
+  /**
+   * @brief Распределители без состояния взаимозаменяемы.
+   */
+  template <typename U>
+  bool operator!=(const TrackingAllocator<U, Subsystem> &) const {
+    return false;
+  }
+};
+
+//! Строка, память которой учитывается за подсистемой.
+template <MemorySubsystem Subsystem>
+using TrackedString =
+    std::basic_string<char, std::char_traits<char>,
+                      TrackingAllocator<char, Subsystem>>;
@@ -0,0 +1,207 @@
+#include "global_trading_exchange_client.h"
+#include "request_handler.h"
+#include "traffic_capture.h"
+
+#include <algorithm>
+#include <fstream>
+#include <streambuf>
+#include <thread>
+
+namespace {
+
+/**
+ * @brief Параметры воспроизведения.
+ */
+struct ReplayOptions {
+  std::string captureFile; //!< Файл записи трафика.
+  bool paced = false; //!< Воспроизводить с исходными интервалами.
+  std::string expectedStateFile; //!< Файл с ожидаемым состоянием биржи.
+  std::string dumpStateFile; //!< Файл для сохранения итогового состояния.
+  //! Проверять согласованность биржи после каждой записи.
+  bool check = false;
+};
+
+/**
+ * @brief Буфер потока, отбрасывающий вывод.
+ */
+class NullBuffer : public std::streambuf {
+protected:
+  int overflow(int c) override { return c; }
+};
+
+/**
+ * @brief Разобрать параметры командной строки.
+ * @param argc Количество аргументов.
+ * @param argv Аргументы.
+ * @return Параметры воспроизведения.
+ */
+ReplayOptions parseOptions(int argc, char *argv[]) {
+  ReplayOptions options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string option = argv[i];
+    if (option == "--paced") {
+      options.paced = true;
+    } else if (option == "--check") {
+      options.check = true;
+    } else if ((option == "--expect-state") && (i + 1 < argc)) {
+      options.expectedStateFile = argv[++i];
+    } else if ((option == "--dump-state") && (i + 1 < argc)) {
+      options.dumpStateFile = argv[++i];
+    } else if (options.captureFile.empty()) {
+      options.captureFile = option;
+    } else {
+      throw std::invalid_argument("Unknown option " + option);
+    }
+  }
+  if (options.captureFile.empty()) {
+    throw std::invalid_argument(
+        "Usage: replay <capture> [--paced] [--check] [--expect-state <file>] "
+        "[--dump-state <file>]");
+  }
+  return options;
+}
+
+/**
+ * @brief Получить перцентиль задержек.
+ * @param latencies Отсортированные задержки.
+ * @param percentile Перцентиль (0-100).
+ * @return Задержка в нс.
+ */
+std::int64_t percentile(const std::vector<std::int64_t> &latencies,
+                        double percentile) {
+  if (latencies.empty()) {
+    return 0;
+  }
+  const std::size_t index = static_cast<std::size_t>(
+      percentile / 100. * static_cast<double>(latencies.size() - 1));
+  return latencies[index];
+}
+
+/**
+ * @brief Проверить согласованность биржи и вывести найденные нарушения.
+ * @param recordNumber Номер обработанной записи.
+ * @param matched Заявки только что совмещены.
+ * @return true-нарушений нет, false-есть.
+ */
+bool checkExchange(std::size_t recordNumber, bool matched) {
+  const std::vector<std::string> errors =
+      GlobalTradingExchangeClient().checkConsistency(matched);
+  for (const std::string &error : errors) {
+    std::cerr << "Record " << recordNumber << ": " << error << std::endl;
+  }
+  return errors.empty();
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+  try {
+    const ReplayOptions options = parseOptions(argc, argv);
+    TrafficReader reader;
+    if (!reader.open(options.captureFile)) {
+      std::cerr << "Cannot read capture " << options.captureFile << std::endl;
+      return 1;
+    }
+
+    std::string expectedState;
+    if (!options.expectedStateFile.empty()) {
+      std::ifstream file(options.expectedStateFile);
+      expectedState.assign(std::istreambuf_iterator<char>(file), {});
+    }
+
+    // Вывод биржи о сделках не должен влиять на измерения.
+    NullBuffer nullBuffer;
+    std::streambuf *coutBuffer = std::cout.rdbuf(&nullBuffer);
+
+    std::map<std::uint32_t, RequestHandler> requestHandlers;
+    std::vector<std::int64_t> latencies;
+    std::size_t ticks = 0;
+    std::int64_t firstTimestamp = 0;
+    std::size_t recordNumber = 0;
+    const auto discardChunk = [](std::string) {};
+    const auto start = std::chrono::steady_clock::now();
+    capture::Record record;
+    while (reader.read(record)) {
+      ++recordNumber;
+      if (options.paced) {
+        if (firstTimestamp == 0) {
+          firstTimestamp = record.timestamp;
+        }
+        std::this_thread::sleep_until(
+            start +
+            std::chrono::nanoseconds(record.timestamp - firstTimestamp));
+      }
+      switch (record.kind) {
+      case capture::RecordKind_Request: {
+        const auto requestStart = std::chrono::steady_clock::now();
+        requestHandlers[record.session].createResponse(record.payload,
+                                                       record.timestamp,
+                                                       discardChunk);
+        latencies.push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - requestStart)
+                .count());
+        if (options.check && !checkExchange(recordNumber, false)) {
+          std::cout.rdbuf(coutBuffer);
+          return 1;
+        }
+        break;
+      }
+      case capture::RecordKind_Tick: {
+        ++ticks;
+        GlobalTradingExchangeClient().process(record.timestamp);
+        if (options.check && !checkExchange(recordNumber, true)) {
+          std::cout.rdbuf(coutBuffer);
+          return 1;
+        }
+        break;
+      }
+      case capture::RecordKind_Disconnect: {
+        requestHandlers.erase(record.session);
+        break;
+      }
+      case capture::RecordKind_State: {
+        if (expectedState.empty()) {
+          expectedState = record.payload;
+        }
+        break;
+      }
+      case capture::RecordKind_Snapshot: {
+        // Снимки передаются только резервным серверам и в захват не пишутся.
+        break;
+      }
+      }
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    std::cout.rdbuf(coutBuffer);
+
+    std::sort(latencies.begin(), latencies.end());
+    std::cout << "Requests: " << latencies.size() << ", ticks: " << ticks
+              << ", time: " << elapsed.count() << " s, throughput: "
+              << static_cast<double>(latencies.size()) / elapsed.count()
+              << " req/s" << std::endl;
+    std::cout << "Latency (ns): p50 " << percentile(latencies, 50.) << ", p99 "
+              << percentile(latencies, 99.) << ", p99.9 "
+              << percentile(latencies, 99.9) << ", max "
+              << percentile(latencies, 100.) << std::endl;
+
+    const std::string state = GlobalTradingExchangeClient().dumpState();
+    if (!options.dumpStateFile.empty()) {
+      std::ofstream(options.dumpStateFile) << state;
+    }
+    if (expectedState.empty()) {
+      std::cout << "No expected state to compare with" << std::endl;
+    } else if (state == expectedState) {
+      std::cout << "State matches" << std::endl;
+    } else {
+      std::cout << "State mismatch" << std::endl;
+      return 1;
+    }
+  } catch (std::exception &e) {
+    std::cerr << "Replay exception: " << e.what() << "\n";
+    return 1;
+  }
+
+  return 0;
+}
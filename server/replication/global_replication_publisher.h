@@ -0,0 +1,11 @@
+#pragma once
+
+#include "replication_publisher.h"
+
+/**
+ * @brief Глобальный публикатор потока событий биржи.
+ */
+inline ReplicationPublisher &GlobalReplicationPublisher() {
+  static ReplicationPublisher replicationPublisher;
+  return replicationPublisher;
+}
@@ -0,0 +1,136 @@
+#include "replica_client.h"
+#include "global_replication_publisher.h"
+#include "global_trading_exchange_client.h"
+#include "session.h"
+
+ReplicaClient::ReplicaClient(boost::asio::io_service &io_service,
+                             const std::string &address, unsigned short port,
+                             std::function<void()> onPromote)
+    : socket_(io_service), onPromote_(std::move(onPromote)) {
+  socket_.connect(
+      tcp::endpoint(boost::asio::ip::make_address(address), port));
+  socket_.set_option(tcp::no_delay(true));
+  std::cout << "Replica of " << address << ":" << port << std::endl;
+  startRead();
+}
+
+void ReplicaClient::promote() {
+  if (promoted_ || stopped_) {
+    return;
+  }
+  promoted_ = true;
+  boost::system::error_code ignored;
+  socket_.close(ignored);
+  std::cout << "Promoted to primary after " << received_ << " events"
+            << std::endl;
+  Session::reserveIds(lastSession_);
+  onPromote_();
+}
+
+void ReplicaClient::stop() {
+  stopped_ = true;
+  boost::system::error_code ignored;
+  socket_.close(ignored);
+}
+
+void ReplicaClient::startRead() {
+  socket_.async_read_some(
+      boost::asio::buffer(data_, sizeof(data_)),
+      boost::bind(&ReplicaClient::handleRead, this,
+                  boost::asio::placeholders::error,
+                  boost::asio::placeholders::bytes_transferred));
+}
+
+void ReplicaClient::handleRead(const boost::system::error_code &error,
+                               std::size_t bytes_transferred) {
+  if (promoted_ || stopped_) {
+    return;
+  }
+  if (error) {
+    std::cout << "Primary connection lost: " << error.message() << std::endl;
+    promote();
+    return;
+  }
+  pending_.append(data_, bytes_transferred);
+  std::size_t offset = 0;
+  capture::Record record;
+  while (const std::size_t size = capture::parseRecord(
+             pending_.data() + offset, pending_.size() - offset, record)) {
+    offset += size;
+    ++received_;
+    applyRecord(record);
+  }
+  pending_.erase(0, offset);
+  sendAck();
+  startRead();
+}
+
+void ReplicaClient::applyRecord(const capture::Record &record) {
+  if (record.kind == capture::RecordKind_Snapshot) {
+    applySnapshot(record);
+    return;
+  }
+  // Резервный сервер ведёт такой же журнал, чтобы после перехода в роль
+  // основного передавать события следующим резервным серверам.
+  GlobalReplicationPublisher().publish(
+      record.kind, record.session, record.timestamp, record.payload.data(),
+      static_cast<std::uint32_t>(record.payload.size()));
+  lastSession_ = std::max(lastSession_, record.session);
+  switch (record.kind) {
+  case capture::RecordKind_Request: {
+    RequestHandler &requestHandler = requestHandlers_[record.session];
+    const std::size_t userId = requestHandler.getUserId();
+    requestHandler.createResponse(record.payload, record.timestamp,
+                                  [](std::string) {});
+    if (requestHandler.getUserId() != userId) {
+      GlobalReplicationPublisher().bindSession(record.session,
+                                               requestHandler.getUserId());
+    }
+    break;
+  }
+  case capture::RecordKind_Tick: {
+    GlobalTradingExchangeClient().process(record.timestamp);
+    break;
+  }
+  case capture::RecordKind_Disconnect: {
+    requestHandlers_.erase(record.session);
+    break;
+  }
+  case capture::RecordKind_State:
+  case capture::RecordKind_Snapshot: {
+    break;
+  }
+  }
+}
+
+void ReplicaClient::applySnapshot(const capture::Record &record) {
+  const nlohmann::json snapshot = nlohmann::json::parse(record.payload);
+  GlobalTradingExchangeClient().loadSnapshot(snapshot.at("exchange"),
+                                             record.timestamp);
+  for (const nlohmann::json &session : snapshot.at("sessions")) {
+    const std::uint32_t id = session.at(0).get<std::uint32_t>();
+    const std::size_t userId = session.at(1).get<std::size_t>();
+    requestHandlers_[id].setUserId(userId);
+    GlobalReplicationPublisher().bindSession(id, userId);
+  }
+  lastSession_ =
+      std::max(lastSession_, snapshot.at("lastSession").get<std::uint32_t>());
+  std::cout << "Snapshot applied: " << record.payload.size() << " bytes"
+            << std::endl;
+}
+
+void ReplicaClient::sendAck() {
+  if (writingAck_ || (ackBuffer_ == received_)) {
+    return;
+  }
+  writingAck_ = true;
+  ackBuffer_ = received_;
+  boost::asio::async_write(
+      socket_, boost::asio::buffer(&ackBuffer_, sizeof(ackBuffer_)),
+      [this](const boost::system::error_code &error, std::size_t) {
+        writingAck_ = false;
+        if (!error) {
+          sendAck();
+        }
+      });
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include "request_handler.h"
+#include "traffic_capture.h"
+
+#include <functional>
+
+using boost::asio::ip::tcp;
+
+/**
+ * @brief Резервный сервер.
+ * @details Подключается к основному серверу, получает снимок состояния биржи
+ * и поток последующих событий и применяет их к собственному экземпляру биржи,
+ * подтверждая получение. При
+ * потере связи с основным сервером или по команде становится основным.
+ */
+class ReplicaClient {
+public:
+  /**
+   * @brief Конструктор.
+   * @param io_service Сервис для сетевых операций.
+   * @param address Адрес основного сервера.
+   * @param port Порт репликации основного сервера.
+   * @param onPromote Вызывается при переходе в роль основного сервера.
+   */
+  ReplicaClient(boost::asio::io_service &io_service,
+                const std::string &address, unsigned short port,
+                std::function<void()> onPromote);
+
+  /**
+   * @brief Стать основным сервером.
+   */
+  void promote();
+
+  /**
+   * @brief Отключиться от основного сервера без перехода в роль основного.
+   */
+  void stop();
+
+private:
+  tcp::socket socket_;                  //!< Сокет.
+  char data_[limits::buffSize * 64];    //!< Принимаемые данные.
+  std::string pending_;                 //!< Не полностью принятые записи.
+  std::uint64_t received_ = 0;          //!< Количество принятых записей.
+  std::uint64_t ackBuffer_ = 0;         //!< Отправляемое подтверждение.
+  bool writingAck_ = false;             //!< Выполняется ли отправка.
+  bool promoted_ = false;               //!< Стал ли сервер основным.
+  bool stopped_ = false;                //!< Остановлен ли сервер.
+  std::uint32_t lastSession_ = 0; //!< Наибольший номер сессии в журнале.
+  std::function<void()> onPromote_;     //!< Обработчик перехода.
+  //! Обработчики запросов по номеру сессии основного сервера.
+  std::map<std::uint32_t, RequestHandler> requestHandlers_;
+
+  /**
+   * @brief Начать приём событий.
+   */
+  void startRead();
+
+  /**
+   * @brief Обработать принятые события.
+   * @param error Ошибка чтения.
+   * @param bytes_transferred Количество принятых байт.
+   */
+  void handleRead(const boost::system::error_code &error,
+                  std::size_t bytes_transferred);
+
+  /**
+   * @brief Применить событие к бирже.
+   * @param record Событие.
+   */
+  void applyRecord(const capture::Record &record);
+
+  /**
+   * @brief Восстановить биржу и сессии из снимка состояния.
+   * @param record Запись снимка.
+   */
+  void applySnapshot(const capture::Record &record);
+
+  /**
+   * @brief Отправить подтверждение получения событий.
+   */
+  void sendAck();
+};
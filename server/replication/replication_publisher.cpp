@@ -0,0 +1,188 @@
+#include "replication_publisher.h"
+#include "global_memory_accounting.h"
+#include "global_trading_exchange_client.h"
+
+void ReplicationPublisher::enableJournal(bool waitForAck) {
+  journalEnabled_ = true;
+  waitForAck_ = waitForAck;
+}
+
+void ReplicationPublisher::start(boost::asio::io_service &io_service,
+                                 unsigned short port) {
+  io_service_ = &io_service;
+  acceptor_ = std::make_unique<tcp::acceptor>(
+      io_service, tcp::endpoint(tcp::v4(), port));
+  std::cout << "Replication listen " << port << " port" << std::endl;
+  startAccept();
+}
+
+void ReplicationPublisher::stop() {
+  if (acceptor_) {
+    boost::system::error_code ignored;
+    acceptor_->close(ignored);
+  }
+  while (!replicas_.empty()) {
+    dropReplica(replicas_.back());
+  }
+}
+
+void ReplicationPublisher::publish(capture::RecordKind kind,
+                                   std::uint32_t session,
+                                   std::int64_t timestamp, const char *data,
+                                   std::uint32_t size,
+                                   std::function<void()> onAck) {
+  if (!journalEnabled_) {
+    if (onAck) {
+      onAck();
+    }
+    return;
+  }
+  lastSession_ = std::max(lastSession_, session);
+  if (kind == capture::RecordKind_Disconnect) {
+    sessionUsers_.erase(session);
+  }
+  journal_.emplace_back();
+  capture::appendRecord(journal_.back(), kind, session, timestamp, data,
+                        size);
+  GlobalMemoryAccounting().allocated(MemorySubsystem_Replication,
+                                     journal_.back().capacity());
+  for (const std::shared_ptr<Replica> &replica : replicas_) {
+    sendJournal(replica);
+  }
+  if (onAck) {
+    pendingAcks_.emplace_back(journalEnd(), std::move(onAck));
+    completeAcks();
+  }
+  trimJournal();
+}
+
+void ReplicationPublisher::bindSession(std::uint32_t session,
+                                       std::size_t userId) {
+  if (journalEnabled_) {
+    sessionUsers_[session] = userId;
+  }
+}
+
+std::string ReplicationPublisher::makeSnapshot() const {
+  nlohmann::json snapshot;
+  snapshot["exchange"] = GlobalTradingExchangeClient().saveSnapshot();
+  snapshot["sessions"] = sessionUsers_;
+  snapshot["lastSession"] = lastSession_;
+  const std::string payload = snapshot.dump();
+  std::string record;
+  capture::appendRecord(record, capture::RecordKind_Snapshot, 0,
+                        common::currentTimestamp(), payload.data(),
+                        static_cast<std::uint32_t>(payload.size()));
+  return record;
+}
+
+void ReplicationPublisher::startAccept() {
+  std::shared_ptr<Replica> replica =
+      std::make_shared<Replica>(*io_service_);
+  acceptor_->async_accept(
+      replica->socket,
+      [this, replica](const boost::system::error_code &error) {
+        if (!error) {
+          std::cout << "Replica connected" << std::endl;
+          replica->socket.set_option(tcp::no_delay(true));
+          // Снимок соответствует всем опубликованным событиям, дальше
+          // отправляются только новые.
+          replica->base = journalEnd();
+          replica->sent = replica->base;
+          replica->acked = replica->base;
+          replica->writeBuffer = makeSnapshot();
+          replicas_.push_back(replica);
+          sendJournal(replica);
+          startReadAck(replica);
+        }
+        if (acceptor_->is_open()) {
+          startAccept();
+        }
+      });
+}
+
+void ReplicationPublisher::sendJournal(
+    const std::shared_ptr<Replica> &replica) {
+  if (replica->writing) {
+    return;
+  }
+  const std::uint64_t end =
+      std::min(journalEnd(), replica->sent + limits::replicationBatchSize);
+  for (std::uint64_t i = replica->sent; i < end; ++i) {
+    replica->writeBuffer += journal_[i - journalStart_];
+  }
+  replica->sent = end;
+  if (replica->writeBuffer.empty()) {
+    return;
+  }
+  replica->writing = true;
+  boost::asio::async_write(
+      replica->socket, boost::asio::buffer(replica->writeBuffer),
+      [this, replica](const boost::system::error_code &error, std::size_t) {
+        replica->writing = false;
+        if (error) {
+          dropReplica(replica);
+          return;
+        }
+        replica->writeBuffer.clear();
+        sendJournal(replica);
+      });
+}
+
+void ReplicationPublisher::startReadAck(
+    const std::shared_ptr<Replica> &replica) {
+  boost::asio::async_read(
+      replica->socket,
+      boost::asio::buffer(&replica->ackBuffer, sizeof(replica->ackBuffer)),
+      [this, replica](const boost::system::error_code &error, std::size_t) {
+        if (error) {
+          dropReplica(replica);
+          return;
+        }
+        // Первая принятая запись - снимок, он покрывает события до base.
+        if (replica->ackBuffer != 0) {
+          replica->acked = replica->base + replica->ackBuffer - 1;
+          acked_ = std::max(acked_, replica->acked);
+        }
+        completeAcks();
+        trimJournal();
+        startReadAck(replica);
+      });
+}
+
+void ReplicationPublisher::dropReplica(
+    const std::shared_ptr<Replica> &replica) {
+  const auto replicaIt =
+      std::find(replicas_.begin(), replicas_.end(), replica);
+  if (replicaIt == replicas_.end()) {
+    return;
+  }
+  std::cout << "Replica disconnected" << std::endl;
+  boost::system::error_code ignored;
+  replica->socket.close(ignored);
+  replicas_.erase(replicaIt);
+  completeAcks();
+  trimJournal();
+}
+
+void ReplicationPublisher::completeAcks() {
+  const bool waitForReplica = waitForAck_ && !replicas_.empty();
+  while (!pendingAcks_.empty() &&
+         (!waitForReplica || (pendingAcks_.front().first <= acked_))) {
+    const std::function<void()> onAck = std::move(pendingAcks_.front().second);
+    pendingAcks_.pop_front();
+    onAck();
+  }
+}
+
+void ReplicationPublisher::trimJournal() {
+  std::uint64_t trimEnd = journalEnd();
+  for (const std::shared_ptr<Replica> &replica : replicas_) {
+    trimEnd = std::min(trimEnd, replica->acked);
+  }
+  for (; journalStart_ < trimEnd; ++journalStart_) {
+    GlobalMemoryAccounting().released(MemorySubsystem_Replication,
+                                      journal_.front().capacity());
+    journal_.pop_front();
+  }
+}
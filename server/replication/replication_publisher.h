@@ -0,0 +1,153 @@
+#pragma once
+
+#include "traffic_capture.h"
+
+#include <deque>
+#include <functional>
+#include <map>
+#include <memory>
+
+using boost::asio::ip::tcp;
+
+/**
+ * @brief Публикатор потока событий биржи для резервных серверов.
+ * @details Подключившийся резервный сервер получает снимок состояния биржи и
+ * затем события, влияющие на состояние биржи (в формате записей захвата
+ * трафика). Резервный сервер подтверждает получение количеством принятых
+ * записей, включая снимок. Журнал хранит только события, ещё не
+ * подтверждённые всеми резервными серверами. В синхронном режиме обработчик
+ * подтверждения события вызывается только после подтверждения резервным
+ * сервером.
+ */
+class ReplicationPublisher {
+public:
+  /**
+   * @brief Включить ведение журнала.
+   * @param waitForAck Ожидать подтверждения резервного сервера.
+   */
+  void enableJournal(bool waitForAck);
+
+  /**
+   * @brief Начать приём подключений резервных серверов.
+   * @param io_service Сервис для сетевых операций.
+   * @param port Порт.
+   */
+  void start(boost::asio::io_service &io_service, unsigned short port);
+
+  /**
+   * @brief Прекратить приём подключений и отключить резервные серверы.
+   */
+  void stop();
+
+  /**
+   * @brief Опубликовать событие.
+   * @param kind Тип события.
+   * @param session Номер сессии.
+   * @param timestamp Время события.
+   * @param data Данные.
+   * @param size Размер данных.
+   * @param onAck Вызывается после подтверждения события (сразу, если
+   * ожидание не требуется или резервных серверов нет).
+   */
+  void publish(capture::RecordKind kind, std::uint32_t session,
+               std::int64_t timestamp, const char *data = nullptr,
+               std::uint32_t size = 0, std::function<void()> onAck = {});
+
+  /**
+   * @brief Запомнить пользователя, вошедшего в систему в сессии.
+   * @param session Номер сессии.
+   * @param userId ID пользователя.
+   * @details Связи сессий с пользователями передаются в снимке состояния.
+   * Связь удаляется при публикации закрытия сессии.
+   */
+  void bindSession(std::uint32_t session, std::size_t userId);
+
+private:
+  /**
+   * @brief Подключение резервного сервера.
+   */
+  struct Replica {
+    explicit Replica(boost::asio::io_service &io_service)
+        : socket(io_service) {}
+
+    tcp::socket socket; //!< Сокет.
+    //! Номер первого неотправленного события журнала.
+    std::uint64_t sent = 0;
+    //! Номер первого события, которое ещё может понадобиться резервному
+    //! серверу (предыдущие подтверждены или вошли в снимок).
+    std::uint64_t acked = 0;
+    //! Номер события журнала, с которого началась отправка после снимка.
+    std::uint64_t base = 0;
+    bool writing = false;        //!< Выполняется ли отправка.
+    std::string writeBuffer;     //!< Отправляемые записи.
+    std::uint64_t ackBuffer = 0; //!< Принимаемое подтверждение.
+  };
+
+  bool journalEnabled_ = false; //!< Ведётся ли журнал.
+  bool waitForAck_ = false;     //!< Ожидать подтверждения.
+  //! Журнал закодированных событий, не подтверждённых всеми резервными
+  //! серверами.
+  std::deque<std::string> journal_;
+  //! Номер первого события журнала (количество удалённых событий).
+  std::uint64_t journalStart_ = 0;
+  std::uint64_t acked_ = 0; //!< Количество подтверждённых событий.
+  //! Пользователи, вошедшие в систему, по номеру сессии.
+  std::map<std::uint32_t, std::size_t> sessionUsers_;
+  //! Наибольший номер сессии в опубликованных событиях.
+  std::uint32_t lastSession_ = 0;
+  //! Обработчики, ожидающие подтверждения, по номеру события.
+  std::deque<std::pair<std::uint64_t, std::function<void()>>> pendingAcks_;
+  std::vector<std::shared_ptr<Replica>> replicas_; //!< Резервные серверы.
+  //! Сервис для сетевых операций.
+  boost::asio::io_service *io_service_ = nullptr;
+  std::unique_ptr<tcp::acceptor> acceptor_; //!< Приём подключений.
+
+  /**
+   * @brief Начать ожидание подключения резервного сервера.
+   */
+  void startAccept();
+
+  /**
+   * @brief Количество опубликованных событий.
+   */
+  std::uint64_t journalEnd() const { return journalStart_ + journal_.size(); }
+
+  /**
+   * @brief Создать запись снимка состояния биржи и сессий.
+   * @return Закодированная запись.
+   */
+  std::string makeSnapshot() const;
+
+  /**
+   * @brief Отправить резервному серверу неотправленные события.
+   * @param replica Резервный сервер.
+   * @details За одну запись в сокет отправляется не больше
+   * limits::replicationBatchSize событий.
+   */
+  void sendJournal(const std::shared_ptr<Replica> &replica);
+
+  /**
+   * @brief Начать приём подтверждения.
+   * @param replica Резервный сервер.
+   */
+  void startReadAck(const std::shared_ptr<Replica> &replica);
+
+  /**
+   * @brief Отключить резервный сервер.
+   * @param replica Резервный сервер.
+   */
+  void dropReplica(const std::shared_ptr<Replica> &replica);
+
+  /**
+   * @brief Вызвать обработчики подтверждённых событий.
+   * @details Если резервных серверов нет, вызываются все обработчики.
+   */
+  void completeAcks();
+
+  /**
+   * @brief Удалить из журнала события, подтверждённые всеми резервными
+   * серверами.
+   * @details Без резервных серверов журнал очищается полностью.
+   */
+  void trimJournal();
+};
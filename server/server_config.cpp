@@ -0,0 +1,124 @@
+#include "server_config.h"
+
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+/**
+ * @brief Разобрать значение-переключатель.
+ * @param option Параметр.
+ * @param value Значение: on или off.
+ * @return true-включено, false-выключено.
+ */
+bool parseSwitch(const std::string &option, const std::string &value) {
+  if ((value != "on") && (value != "off")) {
+    throw std::invalid_argument(option + " must be on or off");
+  }
+  return value == "on";
+}
+
+/**
+ * @brief Применить параметр запуска.
+ * @param config Параметры запуска сервера.
+ * @param option Параметр.
+ * @param value Значение.
+ */
+void applyOption(ServerConfig &config, const std::string &option,
+                 const std::string &value);
+
+/**
+ * @brief Применить параметры из файла.
+ * @param config Параметры запуска сервера.
+ * @param fileName Файл параметров.
+ */
+void applyConfigFile(ServerConfig &config, const std::string &fileName) {
+  std::ifstream file(fileName);
+  if (!file) {
+    throw std::invalid_argument("Cannot read config " + fileName);
+  }
+  std::string line;
+  while (std::getline(file, line)) {
+    std::istringstream stream(line);
+    std::string option;
+    std::string value;
+    if (!(stream >> option) || (option[0] == '#')) {
+      continue;
+    }
+    if (!(stream >> value)) {
+      throw std::invalid_argument("Missing value for option " + option);
+    }
+    applyOption(config, "--" + option, value);
+  }
+}
+
+void applyOption(ServerConfig &config, const std::string &option,
+                 const std::string &value) {
+  if (option == "--config") {
+    applyConfigFile(config, value);
+  } else if (option == "--port") {
+    config.port = static_cast<unsigned short>(std::stoi(value));
+  } else if (option == "--capture") {
+    config.captureFile = value;
+  } else if (option == "--trades-dir") {
+    config.tradesDirectory = value;
+  } else if (option == "--replication-port") {
+    config.replicationPort = static_cast<unsigned short>(std::stoi(value));
+  } else if (option == "--replication-ack") {
+    if ((value != "sync") && (value != "async")) {
+      throw std::invalid_argument("--replication-ack must be sync or async");
+    }
+    config.waitForReplicaAck = value == "sync";
+  } else if (option == "--replica-of") {
+    const std::size_t separator = value.rfind(':');
+    if (separator == std::string::npos) {
+      throw std::invalid_argument("--replica-of must be address:port");
+    }
+    config.primaryAddress = value.substr(0, separator);
+    config.primaryPort =
+        static_cast<unsigned short>(std::stoi(value.substr(separator + 1)));
+  } else if (option == "--io-threads") {
+    config.ioThreads = std::stoul(value);
+    if (config.ioThreads == 0) {
+      throw std::invalid_argument("--io-threads must be positive");
+    }
+  } else if (option == "--io-cpu") {
+    config.ioCpu = std::stoi(value);
+  } else if (option == "--engine-cpu") {
+    config.engineCpu = std::stoi(value);
+  } else if (option == "--wait") {
+    if (value == "block") {
+      config.waitStrategy = WaitStrategy_Block;
+    } else if (value == "yield") {
+      config.waitStrategy = WaitStrategy_Yield;
+    } else if (value == "spin") {
+      config.waitStrategy = WaitStrategy_Spin;
+    } else {
+      throw std::invalid_argument("--wait must be block, yield or spin");
+    }
+  } else if (option == "--lock-memory") {
+    config.lockMemory = parseSwitch(option, value);
+  } else if (option == "--order-pool") {
+    config.orderPoolSize = std::stoul(value);
+  } else if (option == "--session-pool") {
+    config.sessionPoolSize = std::stoul(value);
+  } else if (option == "--huge-pages") {
+    config.hugePages = parseSwitch(option, value);
+  } else {
+    throw std::invalid_argument("Unknown option " + option);
+  }
+}
+
+} // namespace
+
+ServerConfig parseServerConfig(int argc, char *argv[]) {
+  ServerConfig config;
+  for (int i = 1; i < argc; ++i) {
+    const std::string option = argv[i];
+    if (i + 1 >= argc) {
+      throw std::invalid_argument("Missing value for option " + option);
+    }
+    applyOption(config, option, argv[++i]);
+  }
+  return config;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include "common.h"
+#include "low_latency.h"
+
+/**
+ * @brief Параметры запуска сервера.
+ */
+struct ServerConfig {
+  //! Порт для подключения клиентов.
+  unsigned short port = common::defaultPort;
+  std::string captureFile; //!< Файл записи трафика (пусто - не записывать).
+  //! Каталог ленты сделок (пусто - хранить в памяти).
+  std::string tradesDirectory;
+  //! Порт для подключения резервных серверов (0 - без репликации).
+  unsigned short replicationPort = 0;
+  //! Отвечать клиентам только после подтверждения резервным сервером.
+  bool waitForReplicaAck = false;
+  //! Адрес основного сервера (пусто - сервер основной).
+  std::string primaryAddress;
+  //! Порт репликации основного сервера.
+  unsigned short primaryPort = 0;
+  //! Количество потоков ввода-вывода. Каждый поток принимает подключения
+  //! своим сокетом на общем порту (SO_REUSEPORT).
+  std::size_t ioThreads = 1;
+  //! Ядро процессора первого потока ввода-вывода, остальные привязываются к
+  //! следующим ядрам (-1 - без привязки).
+  int ioCpu = -1;
+  //! Ядро процессора потока биржи (-1 - без привязки).
+  int engineCpu = -1;
+  //! Способ ожидания событий потоками ввода-вывода и биржи.
+  WaitStrategy waitStrategy = WaitStrategy_Block;
+  //! Закрепить память процесса (mlockall).
+  bool lockMemory = false;
+  //! Количество заявок, память для которых выделяется при запуске.
+  std::size_t orderPoolSize = 0;
+  //! Количество сессий, память для которых выделяется при запуске в каждом
+  //! потоке ввода-вывода.
+  std::size_t sessionPoolSize = 0;
+  //! Выделять память заявок и сессий большими страницами.
+  bool hugePages = false;
+};
+
+/**
+ * @brief Разобрать параметры командной строки.
+ * @param argc Количество аргументов.
+ * @param argv Аргументы.
+ * @return Параметры запуска сервера.
+ * @details Параметр --config задаёт файл, каждая строка которого содержит
+ * параметр без "--" и его значение, например "engine-cpu 2". Строки,
+ * начинающиеся с #, пропускаются. Параметры применяются по порядку, более
+ * поздние переопределяют более ранние. Бросает std::invalid_argument при
+ * неизвестном параметре.
+ */
+ServerConfig parseServerConfig(int argc, char *argv[]);
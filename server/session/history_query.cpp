@@ -0,0 +1,55 @@
+#include "history_query.h"
+#include "global_trading_exchange_client.h"
+#include "json_writer.h"
+
+#include <algorithm>
+
+bool isHistoryRequest(std::string_view type) {
+  return (type == common::requests::Trades) ||
+         (type == common::requests::Ohlcv);
+}
+
+std::string queryHistory(std::string_view type, std::string_view message) {
+  const nlohmann::json j = nlohmann::json::parse(message);
+  const common::currency::InstrumentId instrument =
+      common::currency::findInstrument(j["instrument"].get<std::string>());
+  if (instrument == common::currency::InstrumentCount) {
+    return "Unknown currency pair";
+  }
+  const common::currency::InstrumentId canonical =
+      common::currency::instruments[instrument].canonical;
+  const TradeStore &tradeStore = GlobalTradingExchangeClient().getTradeStore();
+  std::string response;
+  JsonWriter writer(response);
+  if (type == common::requests::Trades) {
+    const std::size_t limit = std::min(
+        j.value("limit", limits::tradesPageSize), limits::maxTradesPageSize);
+    writer.beginObject().key("trades").beginArray();
+    for (const Trade &trade : tradeStore.getRecentTrades(
+             canonical, limit, canonical != instrument)) {
+      writer.beginArray()
+          .integer(trade.timestamp)
+          .number(trade.price)
+          .number(trade.volume)
+          .integer(trade.aggressor)
+          .endArray();
+    }
+  } else {
+    writer.beginObject().key("bars").beginArray();
+    for (const Bar &bar : tradeStore.getBars(
+             canonical, j["from"].get<std::int64_t>(),
+             j["to"].get<std::int64_t>(), j["interval"].get<std::int64_t>(),
+             limits::maxOhlcvBars, canonical != instrument)) {
+      writer.beginArray()
+          .integer(bar.start)
+          .number(bar.open)
+          .number(bar.high)
+          .number(bar.low)
+          .number(bar.close)
+          .number(bar.volume)
+          .endArray();
+    }
+  }
+  writer.endArray().endObject();
+  return response;
+}
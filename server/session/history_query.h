@@ -0,0 +1,22 @@
+#pragma once
+
+#include "common.h"
+
+/**
+ * @brief Проверить, является ли запрос запросом истории сделок.
+ * @param type Тип запроса.
+ * @return true-запрос Trades или Ohlcv.
+ */
+bool isHistoryRequest(std::string_view type);
+
+/**
+ * @brief Ответить на запрос истории сделок (Trades, Ohlcv).
+ * @param type Тип запроса.
+ * @param message Сообщение запроса в JSON.
+ * @return Ответ в JSON.
+ * @details Читает только ленту сделок, которую можно читать одновременно с
+ * добавлением сделок, поэтому выполняется в потоке ввода-вывода и не
+ * задерживает совмещение заявок. Количество сделок и свечей в ответе
+ * ограничено. Бросает исключение, если сообщение некорректно.
+ */
+std::string queryHistory(std::string_view type, std::string_view message);
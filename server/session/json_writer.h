@@ -0,0 +1,170 @@
+#pragma once
+
+#include <charconv>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+/**
+ * @brief Кодировщик ответов в JSON.
+ * @tparam String Тип строки с результатом.
+ * @details Записывает JSON непосредственно в строку, не строя промежуточное
+ * дерево. Запятые между элементами расставляются автоматически. Числа с
+ * плавающей точкой записываются кратчайшим представлением, которое при
+ * чтении даёт то же значение.
+ */
+template <typename String = std::string> class JsonWriter {
+public:
+  /**
+   * @brief Конструктор.
+   * @param out Строка, в конец которой записывается JSON.
+   */
+  explicit JsonWriter(String &out) : out_(out) {}
+
+  /**
+   * @brief Начать объект.
+   * @return Кодировщик.
+   */
+  JsonWriter &beginObject() {
+    separate();
+    out_ += '{';
+    first_ = true;
+    return *this;
+  }
+
+  /**
+   * @brief Закончить объект.
+   * @return Кодировщик.
+   */
+  JsonWriter &endObject() {
+    out_ += '}';
+    first_ = false;
+    return *this;
+  }
+
+  /**
+   * @brief Начать массив.
+   * @return Кодировщик.
+   */
+  JsonWriter &beginArray() {
+    separate();
+    out_ += '[';
+    first_ = true;
+    return *this;
+  }
+
+  /**
+   * @brief Закончить массив.
+   * @return Кодировщик.
+   */
+  JsonWriter &endArray() {
+    out_ += ']';
+    first_ = false;
+    return *this;
+  }
+
+  /**
+   * @brief Записать ключ объекта.
+   * @param name Ключ.
+   * @return Кодировщик.
+   */
+  JsonWriter &key(std::string_view name) {
+    string(name);
+    out_ += ':';
+    first_ = true;
+    return *this;
+  }
+
+  /**
+   * @brief Записать строку.
+   * @param value Строка.
+   * @return Кодировщик.
+   */
+  JsonWriter &string(std::string_view value) {
+    separate();
+    out_ += '"';
+    for (const char c : value) {
+      switch (c) {
+      case '"':
+        out_ += "\\\"";
+        break;
+      case '\\':
+        out_ += "\\\\";
+        break;
+      case '\n':
+        out_ += "\\n";
+        break;
+      case '\r':
+        out_ += "\\r";
+        break;
+      case '\t':
+        out_ += "\\t";
+        break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          static constexpr char hex[] = "0123456789abcdef";
+          out_ += "\\u00";
+          out_ += hex[(c >> 4) & 0xf];
+          out_ += hex[c & 0xf];
+        } else {
+          out_ += c;
+        }
+      }
+    }
+    out_ += '"';
+    return *this;
+  }
+
+  /**
+   * @brief Записать число с плавающей точкой.
+   * @param value Число (бесконечность и NaN записываются как null).
+   * @return Кодировщик.
+   */
+  JsonWriter &number(float value) {
+    separate();
+    if (!std::isfinite(value)) {
+      out_ += "null";
+      return *this;
+    }
+    char buffer[32];
+    const std::to_chars_result result =
+        std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out_.append(buffer, result.ptr);
+    return *this;
+  }
+
+  /**
+   * @brief Записать целое число.
+   * @tparam T Целый тип или перечисление.
+   * @param value Число.
+   * @return Кодировщик.
+   */
+  template <typename T> JsonWriter &integer(T value) {
+    if constexpr (std::is_enum_v<T>) {
+      return integer(static_cast<std::underlying_type_t<T>>(value));
+    } else {
+      static_assert(std::is_integral_v<T>, "Integer type expected");
+      separate();
+      char buffer[24];
+      const std::to_chars_result result =
+          std::to_chars(buffer, buffer + sizeof(buffer), value);
+      out_.append(buffer, result.ptr);
+      return *this;
+    }
+  }
+
+private:
+  /**
+   * @brief Записать запятую перед элементом, если он не первый.
+   */
+  void separate() {
+    if (!first_) {
+      out_ += ',';
+    }
+    first_ = false;
+  }
+
+  String &out_;       //!< Строка с результатом.
+  bool first_ = true; //!< Следующий элемент первый в объекте или массиве.
+};
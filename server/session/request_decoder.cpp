@@ -0,0 +1,473 @@
+#include "request_decoder.h"
+
+#include <charconv>
+
+namespace {
+
+//! Максимальная вложенность пропускаемых значений.
+constexpr int maxDepth = 32;
+
+/**
+ * @brief Однопроходный разборщик JSON в изменяемом буфере.
+ * @details Разбирает только то, что нужно декодеру запросов. При любой
+ * неожиданности возвращает false, не бросая исключений: такие запросы
+ * разбираются библиотекой JSON.
+ */
+class Scanner {
+public:
+  /**
+   * @brief Конструктор.
+   * @param begin Начало буфера.
+   * @param end Конец буфера.
+   * @param unescape Раскрывать экранирование на месте. Иначе строки с
+   * экранированием не читаются, а буфер не меняется.
+   */
+  Scanner(char *begin, char *end, bool unescape = true)
+      : pos_(begin), end_(end), unescape_(unescape) {}
+
+  /**
+   * @brief Пропустить пробелы и прочитать ожидаемый символ.
+   * @param c Символ.
+   * @return true-символ прочитан, false-в буфере другой символ.
+   */
+  bool expect(char c) {
+    skipSpaces();
+    if ((pos_ != end_) && (*pos_ == c)) {
+      ++pos_;
+      return true;
+    }
+    return false;
+  }
+
+  /**
+   * @brief Проверить, что буфер закончился.
+   * @return true-после пробелов данных нет, false-есть.
+   */
+  bool atEnd() {
+    skipSpaces();
+    return pos_ == end_;
+  }
+
+  /**
+   * @brief Прочитать строку, раскрывая экранирование на месте.
+   * @param value Строка (указывает в буфер).
+   * @return true-строка прочитана, false-нет.
+   * @details Строки с \\u и не-ASCII символами передаются библиотеке JSON,
+   * которая проверяет UTF-8.
+   */
+  bool string(std::string_view &value) {
+    if (!expect('"')) {
+      return false;
+    }
+    char *const begin = pos_;
+    char *out = pos_;
+    while (pos_ != end_) {
+      const char c = *pos_++;
+      if (c == '"') {
+        value = std::string_view(begin, out - begin);
+        return true;
+      }
+      if ((static_cast<unsigned char>(c) < 0x20) ||
+          (static_cast<unsigned char>(c) >= 0x80)) {
+        return false;
+      }
+      if (c != '\\') {
+        *out++ = c;
+        continue;
+      }
+      if (!unescape_ || (pos_ == end_)) {
+        return false;
+      }
+      switch (*pos_++) {
+      case '"':
+        *out++ = '"';
+        break;
+      case '\\':
+        *out++ = '\\';
+        break;
+      case '/':
+        *out++ = '/';
+        break;
+      case 'b':
+        *out++ = '\b';
+        break;
+      case 'f':
+        *out++ = '\f';
+        break;
+      case 'n':
+        *out++ = '\n';
+        break;
+      case 'r':
+        *out++ = '\r';
+        break;
+      case 't':
+        *out++ = '\t';
+        break;
+      default:
+        return false;
+      }
+    }
+    return false;
+  }
+
+  /**
+   * @brief Прочитать число с плавающей точкой.
+   * @param value Число.
+   * @return true-число прочитано, false-нет.
+   */
+  bool number(float &value) {
+    std::string_view token;
+    bool integral = false;
+    if (!numberToken(token, integral)) {
+      return false;
+    }
+    // Преобразования совпадают с библиотекой JSON: целые приводятся к float
+    // напрямую, дробные читаются как double.
+    if (integral) {
+      if (token[0] == '-') {
+        std::int64_t integer = 0;
+        if (!parse(token, integer)) {
+          return false;
+        }
+        value = static_cast<float>(integer);
+      } else {
+        std::uint64_t integer = 0;
+        if (!parse(token, integer)) {
+          return false;
+        }
+        value = static_cast<float>(integer);
+      }
+      return true;
+    }
+    double real = 0.;
+    if (!parse(token, real)) {
+      return false;
+    }
+    value = static_cast<float>(real);
+    return true;
+  }
+
+  /**
+   * @brief Прочитать целое число.
+   * @tparam T Целый тип или перечисление.
+   * @param value Число.
+   * @return true-число прочитано, false-нет (в том числе для дробных чисел).
+   */
+  template <typename T> bool integer(T &value) {
+    std::string_view token;
+    bool integral = false;
+    if (!numberToken(token, integral) || !integral) {
+      return false;
+    }
+    using Integer = typename std::conditional_t<std::is_enum_v<T>,
+                                                std::underlying_type<T>,
+                                                std::common_type<T>>::type;
+    if (token[0] == '-') {
+      std::int64_t integer = 0;
+      if (!parse(token, integer)) {
+        return false;
+      }
+      value = static_cast<T>(static_cast<Integer>(integer));
+    } else {
+      std::uint64_t integer = 0;
+      if (!parse(token, integer)) {
+        return false;
+      }
+      value = static_cast<T>(static_cast<Integer>(integer));
+    }
+    return true;
+  }
+
+  /**
+   * @brief Прочитать объект.
+   * @param member Обработчик поля, вызывается с ключом и должен прочитать
+   * значение.
+   * @return true-объект прочитан, false-нет.
+   */
+  template <typename Member> bool object(Member &&member) {
+    if (!expect('{')) {
+      return false;
+    }
+    if (expect('}')) {
+      return true;
+    }
+    do {
+      std::string_view key;
+      if (!string(key) || !expect(':') || !member(key)) {
+        return false;
+      }
+    } while (expect(','));
+    return expect('}');
+  }
+
+  /**
+   * @brief Пропустить значение любого вида.
+   * @param depth Текущая вложенность.
+   * @return true-значение пропущено, false-значение некорректно.
+   */
+  bool skipValue(int depth = 0) {
+    skipSpaces();
+    if ((pos_ == end_) || (depth > maxDepth)) {
+      return false;
+    }
+    switch (*pos_) {
+    case '"': {
+      std::string_view ignored;
+      return string(ignored);
+    }
+    case '{':
+      return object([this, depth](std::string_view) {
+        return skipValue(depth + 1);
+      });
+    case '[':
+      ++pos_;
+      if (expect(']')) {
+        return true;
+      }
+      do {
+        if (!skipValue(depth + 1)) {
+          return false;
+        }
+      } while (expect(','));
+      return expect(']');
+    case 't':
+      return literal("true");
+    case 'f':
+      return literal("false");
+    case 'n':
+      return literal("null");
+    default: {
+      // Число проверяется на переполнение, как в библиотеке JSON.
+      float ignored = 0.f;
+      return number(ignored);
+    }
+    }
+  }
+
+private:
+  /**
+   * @brief Пропустить пробелы.
+   */
+  void skipSpaces() {
+    while ((pos_ != end_) &&
+           ((*pos_ == ' ') || (*pos_ == '\n') || (*pos_ == '\r') ||
+            (*pos_ == '\t'))) {
+      ++pos_;
+    }
+  }
+
+  /**
+   * @brief Прочитать литерал.
+   * @param text Литерал.
+   * @return true-литерал прочитан, false-нет.
+   */
+  bool literal(std::string_view text) {
+    if (std::string_view(pos_, end_ - pos_).substr(0, text.size()) != text) {
+      return false;
+    }
+    pos_ += text.size();
+    return true;
+  }
+
+  /**
+   * @brief Прочитать число по грамматике JSON.
+   * @param token Текст числа.
+   * @param integral Число записано без дробной части и порядка.
+   * @return true-число прочитано, false-нет.
+   */
+  bool numberToken(std::string_view &token, bool &integral) {
+    skipSpaces();
+    const char *const begin = pos_;
+    const auto digits = [this]() {
+      const char *const start = pos_;
+      while ((pos_ != end_) && (*pos_ >= '0') && (*pos_ <= '9')) {
+        ++pos_;
+      }
+      return pos_ - start;
+    };
+    if ((pos_ != end_) && (*pos_ == '-')) {
+      ++pos_;
+    }
+    const char *const first = pos_;
+    const auto count = digits();
+    if ((count == 0) || ((count > 1) && (*first == '0'))) {
+      return false;
+    }
+    integral = true;
+    if ((pos_ != end_) && (*pos_ == '.')) {
+      ++pos_;
+      integral = false;
+      if (digits() == 0) {
+        return false;
+      }
+    }
+    if ((pos_ != end_) && ((*pos_ == 'e') || (*pos_ == 'E'))) {
+      ++pos_;
+      integral = false;
+      if ((pos_ != end_) && ((*pos_ == '+') || (*pos_ == '-'))) {
+        ++pos_;
+      }
+      if (digits() == 0) {
+        return false;
+      }
+    }
+    token = std::string_view(begin, pos_ - begin);
+    return true;
+  }
+
+  /**
+   * @brief Преобразовать текст числа.
+   * @param token Текст числа.
+   * @param value Число.
+   * @return true-текст преобразован целиком, false-нет.
+   */
+  template <typename T> static bool parse(std::string_view token, T &value) {
+    const std::from_chars_result result =
+        std::from_chars(token.data(), token.data() + token.size(), value);
+    return (result.ec == std::errc()) &&
+           (result.ptr == token.data() + token.size());
+  }
+
+  char *pos_;           //!< Текущая позиция.
+  char *const end_;     //!< Конец буфера.
+  const bool unescape_; //!< Раскрывать экранирование на месте.
+};
+
+/**
+ * @brief Прочитать сумму в формате протокола: {"currencyType":..,"value":..}.
+ * @param scanner Разборщик.
+ * @param currency Валюта.
+ * @param value Значение.
+ * @return true-сумма прочитана, false-нет.
+ */
+bool decodeAmount(Scanner &scanner, common::currency::CurrencyId &currency,
+                  float &value) {
+  bool hasCurrency = false;
+  bool hasValue = false;
+  const bool decoded = scanner.object([&](std::string_view key) {
+    if (key == "currencyType") {
+      std::string_view name;
+      hasCurrency = scanner.string(name);
+      currency = common::currency::findCurrency(name);
+      return hasCurrency;
+    }
+    if (key == "value") {
+      hasValue = scanner.number(value);
+      return hasValue;
+    }
+    return scanner.skipValue();
+  });
+  return decoded && hasCurrency && hasValue;
+}
+
+/**
+ * @brief Декодировать заявку.
+ * @param scanner Разборщик сообщения.
+ * @param order Заявка.
+ * @return true-заявка декодирована, false-нет.
+ */
+bool decodeOrder(Scanner &scanner, common::Order &order) {
+  common::currency::CurrencyId base = common::currency::CurrencyCount;
+  common::currency::CurrencyId quote = common::currency::CurrencyCount;
+  bool hasVolume = false;
+  bool hasPrice = false;
+  bool hasType = false;
+  const bool decoded = scanner.object([&](std::string_view key) {
+    if (key == "volume") {
+      hasVolume = decodeAmount(scanner, base, order.volume);
+      return hasVolume;
+    }
+    if (key == "price") {
+      hasPrice = decodeAmount(scanner, quote, order.price);
+      return hasPrice;
+    }
+    if (key == "type") {
+      hasType = scanner.integer(order.type);
+      return hasType;
+    }
+    if (key == "kind") {
+      return scanner.integer(order.kind);
+    }
+    if (key == "stopPrice") {
+      return scanner.number(order.stopPrice);
+    }
+    if (key == "peak") {
+      return scanner.number(order.peak);
+    }
+    if (key == "timeInForce") {
+      return scanner.integer(order.timeInForce);
+    }
+    if (key == "expireTime") {
+      return scanner.integer(order.expireTime);
+    }
+    if (key == "id") {
+      return scanner.integer(order.id);
+    }
+    return scanner.skipValue();
+  });
+  if (!decoded || !scanner.atEnd() || !hasVolume || !hasPrice || !hasType) {
+    return false;
+  }
+  order.instrument = common::currency::findInstrument(base, quote);
+  return true;
+}
+
+/**
+ * @brief Декодировать пару валюта-сумма: {"pair":[валюта,сумма]}.
+ * @param scanner Разборщик сообщения.
+ * @param command Команда.
+ * @return true-пара декодирована, false-нет.
+ */
+bool decodePair(Scanner &scanner, Command &command) {
+  bool hasPair = false;
+  const bool decoded = scanner.object([&](std::string_view key) {
+    if (key != "pair") {
+      return scanner.skipValue();
+    }
+    std::string_view name;
+    hasPair = scanner.expect('[') && scanner.string(name) &&
+              scanner.expect(',') && scanner.number(command.amount) &&
+              scanner.expect(']');
+    command.currency = common::currency::findCurrency(name);
+    return hasPair;
+  });
+  return decoded && scanner.atEnd() && hasPair;
+}
+
+} // namespace
+
+bool decodeRequest(char *data, std::size_t size, Command &command) {
+  Scanner scanner(data, data + size);
+  bool hasType = false;
+  bool hasMessage = false;
+  const bool decoded = scanner.object([&](std::string_view key) {
+    if (key == "ReqType") {
+      hasType = scanner.string(command.type);
+      return hasType;
+    }
+    if (key == "Message") {
+      hasMessage = scanner.string(command.message);
+      return hasMessage;
+    }
+    return scanner.skipValue();
+  });
+  if (!decoded || !scanner.atEnd() || !hasType || !hasMessage) {
+    return false;
+  }
+
+  // Сообщение раскрыто в том же буфере и разбирается на месте. Раскрытие
+  // экранирования в сообщении испортило бы command.message, поэтому такие
+  // сообщения разбирает библиотека JSON.
+  char *const message = data + (command.message.data() - data);
+  Scanner messageScanner(message, message + command.message.size(), false);
+  if ((command.type == common::requests::Buy) ||
+      (command.type == common::requests::Sell) ||
+      (command.type == common::requests::Cancel)) {
+    return decodeOrder(messageScanner, command.order);
+  }
+  if ((command.type == common::requests::Deposit) ||
+      (command.type == common::requests::Withdraw)) {
+    return decodePair(messageScanner, command);
+  }
+  return true;
+}
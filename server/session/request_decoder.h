@@ -0,0 +1,33 @@
+#pragma once
+
+#include "common.h"
+
+/**
+ * @brief Команда, декодированная из запроса клиента.
+ */
+struct Command {
+  std::string_view type;    //!< Тип запроса (ReqType).
+  std::string_view message; //!< Сообщение запроса (Message).
+  //! Заявка (запросы Buy, Sell, Cancel).
+  common::Order order;
+  //! Валюта (запросы Deposit, Withdraw).
+  common::currency::CurrencyId currency = common::currency::CurrencyCount;
+  float amount = 0.f; //!< Сумма (запросы Deposit, Withdraw).
+};
+
+/**
+ * @brief Декодировать запрос за один проход.
+ * @param data Запрос в JSON. Строки раскрываются на месте, поэтому после
+ * декодирования буфер не является корректным JSON.
+ * @param size Размер запроса.
+ * @param command Команда. Строки команды указывают в буфер запроса.
+ * @return true-запрос декодирован, false-запрос имеет неожиданный вид и должен
+ * быть разобран библиотекой JSON.
+ * @details Декодер знает вид запросов протокола: внешний объект с полями
+ * ReqType и Message, в котором Message запросов Buy, Sell и Cancel содержит
+ * заявку, а запросов Deposit и Withdraw - пару валюта-сумма. Неизвестные поля
+ * пропускаются. Сообщения остальных запросов не разбираются. Сообщения с
+ * экранированием в строках разбирает библиотека JSON: раскрытие на месте
+ * испортило бы command.message.
+ */
+bool decodeRequest(char *data, std::size_t size, Command &command);
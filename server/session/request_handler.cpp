@@ -0,0 +1,141 @@
+#include "request_handler.h"
+#include "global_trading_exchange_client.h"
+#include "history_query.h"
+
+#include <algorithm>
+
+common::Order
+RequestHandler::createOrderFromRequest(std::string_view request) const {
+  common::Order order;
+  nlohmann::json j = nlohmann::json::parse(request);
+  order.instrument = common::currency::findInstrument(
+      common::currency::findCurrency(
+          j["volume"]["currencyType"].get<std::string>()),
+      common::currency::findCurrency(
+          j["price"]["currencyType"].get<std::string>()));
+  order.volume = j["volume"]["value"].get<float>();
+  order.price = j["price"]["value"].get<float>();
+  order.type = j["type"].get<common::OrderType>();
+  order.kind = j.value("kind", common::OrderKind_Limit);
+  order.stopPrice = j.value("stopPrice", 0.f);
+  order.peak = j.value("peak", 0.f);
+  order.timeInForce = j.value("timeInForce", common::TimeInForce_GTC);
+  order.expireTime = j.value("expireTime", std::int64_t(0));
+  if (j.contains("id")) {
+    order.id = j["id"].get<std::uint64_t>();
+  }
+  return order;
+}
+
+OrdersQuery
+RequestHandler::createOrdersQueryFromRequest(std::string_view request) const {
+  OrdersQuery query;
+  if (request.empty()) {
+    return query;
+  }
+  const nlohmann::json j = nlohmann::json::parse(request);
+  query.paged = true;
+  query.cursor = j.value("cursor", std::uint64_t(0));
+  query.limit = std::clamp(j.value("limit", limits::ordersPageSize),
+                           std::size_t(1), limits::maxOrdersPageSize);
+  if (j.contains("instrument")) {
+    query.instrument = common::currency::findInstrument(
+        j["instrument"].get<std::string>());
+  }
+  query.side = j.value("side", common::OrderType_None);
+  return query;
+}
+
+std::size_t RequestHandler::getUserId() const { return userId_; }
+
+void RequestHandler::setUserId(std::size_t userId) { userId_ = userId; }
+
+std::string RequestHandler::createResponse(
+    std::string_view request, std::int64_t timestamp,
+    const std::function<void(std::string)> &chunkSink) {
+  try {
+    Command command;
+    buffer_.assign(request);
+    if (!decodeRequest(buffer_.data(), buffer_.size(), command)) {
+      command = Command();
+      parseRequest(request, command);
+    }
+    return execute(command, timestamp, chunkSink);
+  } catch (const std::exception &) {
+    return "Invalid request";
+  }
+}
+
+void RequestHandler::parseRequest(std::string_view request, Command &command) {
+  const nlohmann::json json = nlohmann::json::parse(request);
+  const std::string &type = json.at("ReqType").get_ref<const std::string &>();
+  const std::string &message =
+      json.at("Message").get_ref<const std::string &>();
+  buffer_.assign(type).append(message);
+  command.type = std::string_view(buffer_).substr(0, type.size());
+  command.message = std::string_view(buffer_).substr(type.size());
+  if ((command.type == common::requests::Buy) ||
+      (command.type == common::requests::Sell) ||
+      (command.type == common::requests::Cancel)) {
+    command.order = createOrderFromRequest(command.message);
+  } else if ((command.type == common::requests::Deposit) ||
+             (command.type == common::requests::Withdraw)) {
+    const nlohmann::json j = nlohmann::json::parse(command.message);
+    const common::CurrencyTypeValue pair(
+        j["pair"].get<common::CurrencyTypeValue>());
+    command.currency = common::currency::findCurrency(pair.first);
+    command.amount = pair.second;
+  }
+}
+
+std::string
+RequestHandler::execute(Command &command, std::int64_t timestamp,
+                        const std::function<void(std::string)> &chunkSink) {
+  const std::string_view reqType = command.type;
+  const std::string_view reqMessage = command.message;
+
+  if (reqType == common::requests::SignIn) {
+    userId_ = GlobalTradingExchangeClient().findUser(std::string(reqMessage));
+    if (userId_ == common::unknownUser) {
+      return TradingExchangeClient::User().name;
+    }
+    return std::to_string(userId_);
+  } else if (reqType == common::requests::SignUp) {
+    userId_ =
+        GlobalTradingExchangeClient().registerNewUser(std::string(reqMessage));
+    return std::to_string(userId_);
+  } else if ((reqType == common::requests::Buy) ||
+             (reqType == common::requests::Sell)) {
+    command.order.userID = userId_;
+    command.order.timestamp = timestamp;
+    return GlobalTradingExchangeClient().registerOrder(command.order);
+  } else if (reqType == common::requests::Balance) {
+    return GlobalTradingExchangeClient().getUserBalance(userId_);
+  } else if (reqType == common::requests::Deposit) {
+    return GlobalTradingExchangeClient().deposit(userId_, command.currency,
+                                                 command.amount);
+  } else if (reqType == common::requests::Withdraw) {
+    return GlobalTradingExchangeClient().withdraw(userId_, command.currency,
+                                                  command.amount);
+  } else if (reqType == common::requests::Orders) {
+    // Все части ответа, кроме последней, сразу ставятся в очередь.
+    std::string lastChunk;
+    GlobalTradingExchangeClient().writeUserOrders(
+        userId_, createOrdersQueryFromRequest(reqMessage),
+        [&chunkSink, &lastChunk](std::string chunk) {
+          if (!lastChunk.empty()) {
+            chunkSink(std::move(lastChunk));
+          }
+          lastChunk = std::move(chunk);
+        });
+    return lastChunk;
+  } else if (reqType == common::requests::Cancel) {
+    command.order.userID = userId_;
+    return GlobalTradingExchangeClient().cancelOrder(command.order);
+  } else if (isHistoryRequest(reqType)) {
+    return queryHistory(reqType, reqMessage);
+  } else if (reqType == common::requests::Memory) {
+    return GlobalMemoryAccounting().report();
+  }
+  return "Unknown request";
+}
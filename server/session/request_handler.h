@@ -0,0 +1,84 @@
+#pragma once
+
+#include "common.h"
+#include "request_decoder.h"
+#include "tracking_allocator.h"
+#include "user_view.h"
+
+#include <functional>
+
+/**
+ * @brief Обработчик запросов клиента.
+ * @details Разбирает запросы протокола и вызывает соответствующие операции
+ * торговой биржи. Не зависит от сети, поэтому используется как сессией, так и
+ * при воспроизведении записанного трафика. Запросы SignIn и SignUp связывают
+ * обработчик с пользователем, остальные запросы выполняются от его имени.
+ */
+class RequestHandler {
+public:
+  /**
+   * @brief Создать ответ на запрос.
+   * @param request Запрос в JSON.
+   * @param timestamp Время получения запроса сервером (нс с начала эпохи).
+   * @param chunkSink Получатель промежуточных частей больших ответов.
+   * @return Ответ (для больших ответов - последняя часть, предыдущие части
+   * уже переданы в chunkSink).
+   * @details Запросы известного вида декодируются за один проход, остальные
+   * разбираются библиотекой JSON. На некорректный запрос возвращается
+   * "Invalid request", исключения разбора наружу не передаются.
+   */
+  std::string createResponse(std::string_view request, std::int64_t timestamp,
+                             const std::function<void(std::string)> &chunkSink);
+
+  /**
+   * @brief Получить ID пользователя, вошедшего в систему.
+   * @return ID пользователя или common::unknownUser.
+   */
+  std::size_t getUserId() const;
+
+  /**
+   * @brief Связать обработчик с пользователем без запроса входа.
+   * @param userId ID пользователя.
+   * @details Используется при восстановлении сессий из снимка состояния.
+   */
+  void setUserId(std::size_t userId);
+
+private:
+  //! Пользователь, вошедший в систему.
+  std::size_t userId_ = common::unknownUser;
+  //! Буфер декодируемого запроса (память используется повторно).
+  TrackedString<MemorySubsystem_Serialization> buffer_;
+
+  /**
+   * @brief Разобрать запрос библиотекой JSON.
+   * @param request Запрос.
+   * @param command Команда. Сообщение сохраняется в буфере запроса.
+   * @details Бросает исключение, если запрос некорректен.
+   */
+  void parseRequest(std::string_view request, Command &command);
+
+  /**
+   * @brief Выполнить команду.
+   * @param command Команда.
+   * @param timestamp Время получения запроса сервером (нс с начала эпохи).
+   * @param chunkSink Получатель промежуточных частей больших ответов.
+   * @return Ответ.
+   */
+  std::string execute(Command &command, std::int64_t timestamp,
+                      const std::function<void(std::string)> &chunkSink);
+
+  /**
+   * @brief Создать заявку из запроса.
+   * @param request Запрос.
+   * @return Заявка.
+   */
+  common::Order createOrderFromRequest(std::string_view request) const;
+
+  /**
+   * @brief Создать параметры запроса списка заявок.
+   * @param request Запрос: пустой для полного списка или JSON с полями
+   * cursor, limit, instrument, side для постраничного ответа.
+   * @return Параметры запроса.
+   */
+  OrdersQuery createOrdersQueryFromRequest(std::string_view request) const;
+};
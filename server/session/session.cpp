@@ -1,114 +1,294 @@
 #include "session.h"
-#include "global_trading_exchange_client.h"
+#include "global_replication_publisher.h"
+#include "global_traffic_capture.h"
+#include "history_query.h"
 
-Session::Session(boost::asio::io_service &io_service) : socket_(io_service) {}
+#include <atomic>
+#include <mutex>
 
-tcp::socket &Session::getSocket() { return socket_; }
+namespace {
+//! Номер последней созданной сессии.
+std::atomic<std::uint32_t> lastSessionId = 0;
+} // namespace
+
+Session::Session(tcp::socket socket, EngineThread &engine)
+    : socket_(std::move(socket)), engine_(engine),
+      rateLimit_(limits::sessionRequestRate, limits::sessionRequestBurst),
+      id_(++lastSessionId), idleTimer_(socket_.get_executor()),
+      writeSignal_(socket_.get_executor(),
+                   std::chrono::steady_clock::time_point::max()),
+      readSignal_(socket_.get_executor(),
+                  std::chrono::steady_clock::time_point::max()) {}
+
+Session::~Session() {
+  for (const std::string &response : outbox_) {
+    GlobalMemoryAccounting().released(MemorySubsystem_Sessions,
+                                      response.capacity());
+  }
+  for (const Reply &reply : replies_) {
+    for (const std::string &chunk : reply.chunks) {
+      GlobalMemoryAccounting().released(MemorySubsystem_Sessions,
+                                        chunk.capacity());
+    }
+  }
+  boost::asio::post(engine_.getContext(), [id = id_]() {
+    const std::int64_t timestamp = common::currentTimestamp();
+    GlobalTrafficCapture().write(capture::RecordKind_Disconnect, id,
+                                 timestamp);
+    GlobalReplicationPublisher().publish(capture::RecordKind_Disconnect, id,
+                                         timestamp);
+  });
+}
+
+void Session::reserveIds(std::uint32_t lastId) {
+  std::uint32_t current = lastSessionId;
+  while ((current < lastId) &&
+         !lastSessionId.compare_exchange_weak(current, lastId)) {
+  }
+}
 
 void Session::startSession() {
-  socket_.async_read_some(
-      boost::asio::buffer(data_, limits::buffSize),
-      boost::bind(&Session::handleRead, this, boost::asio::placeholders::error,
-                  boost::asio::placeholders::bytes_transferred));
+  lastActivity_ = std::chrono::steady_clock::now();
+  const auto executor = socket_.get_executor();
+  boost::asio::co_spawn(
+      executor, [self = shared_from_this()]() { return self->readRequests(); },
+      boost::asio::detached);
+  boost::asio::co_spawn(
+      executor,
+      [self = shared_from_this()]() { return self->writeResponses(); },
+      boost::asio::detached);
+  boost::asio::co_spawn(
+      executor, [self = shared_from_this()]() { return self->watchIdle(); },
+      boost::asio::detached);
 }
 
-void Session::handleRead(const boost::system::error_code &error,
-                         size_t bytes_transferred) {
-  if (!error) {
-    data_[bytes_transferred] = '\0';
-    const nlohmann::json j = nlohmann::json::parse(data_);
-    const std::string response = createResponse(j);
-    boost::asio::async_write(socket_,
-                             boost::asio::buffer(response, response.size()),
-                             boost::bind(&Session::handleWrite, this,
-                                         boost::asio::placeholders::error));
-  } else {
-    delete this;
+boost::asio::awaitable<void> Session::readRequests() {
+  try {
+    bool awaitReplies = false;
+    std::size_t offset = 0; // Начало неразобранных данных в received_.
+    while (!closed_) {
+      if ((outboxSize_ >= limits::outboxHighWatermark) ||
+          (replies_.size() >= limits::maxPipelinedRequests) ||
+          (awaitReplies && !replies_.empty())) {
+        boost::system::error_code ignored;
+        co_await readSignal_.async_wait(
+            boost::asio::redirect_error(boost::asio::use_awaitable, ignored));
+        continue;
+      }
+      awaitReplies = false;
+      const std::size_t end =
+          received_.find(common::messageDelimiter, offset);
+      if (end == received_.npos) {
+        received_.erase(0, offset);
+        offset = 0;
+        if (received_.size() > limits::maxRequestSize) {
+          std::cout << "Oversized request, session closed" << std::endl;
+          close();
+          break;
+        }
+        const std::size_t bytes_transferred =
+            co_await socket_.async_read_some(
+                boost::asio::buffer(data_, limits::buffSize),
+                boost::asio::use_awaitable);
+        lastActivity_ = std::chrono::steady_clock::now();
+        received_.append(data_, bytes_transferred);
+        continue;
+      }
+      std::string_view request(received_.data() + offset, end - offset);
+      offset = end + 1;
+      if (!request.empty() && (request.back() == '\r')) {
+        request.remove_suffix(1);
+      }
+      if (request.empty()) {
+        continue;
+      }
+      const std::uint64_t reply = openReply();
+      if (!rateLimit_.consume() || !consumeUserToken(userId_)) {
+        deliver(reply, "Rate limit exceeded", true);
+        continue;
+      }
+      decodeBuffer_.assign(request);
+      Command command;
+      const bool decoded =
+          decodeRequest(decodeBuffer_.data(), decodeBuffer_.size(), command);
+      if (decoded && isHistoryRequest(command.type)) {
+        deliver(reply, queryHistory(command), true);
+        continue;
+      }
+      // Вход в систему меняет пользователя, по которому проверяется лимит
+      // частоты следующих запросов.
+      awaitReplies = !decoded || (command.type == common::requests::SignIn) ||
+                     (command.type == common::requests::SignUp);
+      execute(std::string(request), reply);
+    }
+  } catch (const std::exception &) {
+    close();
   }
 }
 
-void Session::handleWrite(const boost::system::error_code &error) {
-  if (!error) {
-    socket_.async_read_some(
-        boost::asio::buffer(data_, limits::buffSize),
-        boost::bind(&Session::handleRead, this,
-                    boost::asio::placeholders::error,
-                    boost::asio::placeholders::bytes_transferred));
-  } else {
-    delete this;
+boost::asio::awaitable<void> Session::writeResponses() {
+  try {
+    while (!closed_) {
+      if (outbox_.empty()) {
+        boost::system::error_code ignored;
+        co_await writeSignal_.async_wait(
+            boost::asio::redirect_error(boost::asio::use_awaitable, ignored));
+        continue;
+      }
+      co_await boost::asio::async_write(socket_,
+                                        boost::asio::buffer(outbox_.front()),
+                                        boost::asio::use_awaitable);
+      outboxSize_ -= outbox_.front().size();
+      GlobalMemoryAccounting().released(MemorySubsystem_Sessions,
+                                        outbox_.front().capacity());
+      outbox_.pop_front();
+      if (outboxSize_ <= limits::outboxLowWatermark) {
+        readSignal_.cancel();
+      }
+    }
+  } catch (const std::exception &) {
+    close();
   }
 }
 
-common::Order
-Session::createOrderFromRequest(const std::string &request) const {
-  common::Order order;
-  nlohmann::json j = nlohmann::json::parse(request);
-  order.userID = j["userID"].get<std::string>();
-  order.volume.first = j["volume"]["currencyType"].get<std::string>();
-  order.volume.second = j["volume"]["value"].get<float>();
-  order.price.first = j["price"]["currencyType"].get<std::string>();
-  order.price.second = j["price"]["value"].get<float>();
-  order.time = j["time"].get<std::time_t>();
-  order.type = j["type"].get<common::OrderType>();
-  return order;
+boost::asio::awaitable<void> Session::watchIdle() {
+  while (!closed_) {
+    idleTimer_.expires_at(lastActivity_ + limits::idleTimeout);
+    boost::system::error_code ignored;
+    co_await idleTimer_.async_wait(
+        boost::asio::redirect_error(boost::asio::use_awaitable, ignored));
+    if (!closed_ && (std::chrono::steady_clock::now() - lastActivity_ >=
+                     limits::idleTimeout)) {
+      std::cout << "Idle session disconnected" << std::endl;
+      close();
+    }
+  }
 }
 
-std::string Session::createResponse(const nlohmann::json &json) {
-  const std::string reqType = json["ReqType"];
-  const std::string reqMessage = json["Message"];
-  const std::string reqUserId = json["UserId"];
-
-  if (reqType == common::requests::SignIn) {
-    return GlobalTradingExchangeClient().getUserByName(reqMessage).userId;
-  } else if (reqType == common::requests::SignUp) {
-    return GlobalTradingExchangeClient().registerNewUser(reqMessage);
-  } else if ((reqType == common::requests::Buy) ||
-             (reqType == common::requests::Sell)) {
-    const common::Order order = createOrderFromRequest(reqMessage);
-    return GlobalTradingExchangeClient().registerOrder(order);
-  } else if (reqType == common::requests::Balance) {
-    nlohmann::json j;
-    const TradingExchangeClient::User user =
-        GlobalTradingExchangeClient().getUserById(reqUserId);
-    for (const auto &currencyTypeValue : user.balance) {
-      j[currencyTypeValue.first] = currencyTypeValue.second;
+void Session::execute(std::string data, std::uint64_t reply) {
+  // Обработчик запросов используется только в потоке биржи. Части ответа
+  // передаются в поток ввода-вывода в порядке создания.
+  boost::asio::post(engine_.getContext(), [self = shared_from_this(),
+                                           data = std::move(data), reply]() {
+    const std::int64_t timestamp = common::currentTimestamp();
+    GlobalTrafficCapture().write(capture::RecordKind_Request, self->id_,
+                                 timestamp, data.data(),
+                                 static_cast<std::uint32_t>(data.size()));
+    const std::size_t userId = self->requestHandler_.getUserId();
+    std::string lastChunk = self->requestHandler_.createResponse(
+        data, timestamp, [&self, reply](std::string chunk) {
+          boost::asio::post(
+              self->socket_.get_executor(),
+              [self, reply, chunk = std::move(chunk)]() mutable {
+                self->deliver(reply, std::move(chunk), false);
+              });
+        });
+    const std::size_t newUserId = self->requestHandler_.getUserId();
+    if (newUserId != userId) {
+      GlobalReplicationPublisher().bindSession(self->id_, newUserId);
     }
-    return j.dump();
-  } else if (reqType == common::requests::Deposit) {
-    nlohmann::json j = nlohmann::json::parse(reqMessage);
-    const common::CurrencyTypeValue pair(
-        j["pair"].get<common::CurrencyTypeValue>());
-    return GlobalTradingExchangeClient().deposit(reqUserId, pair);
-  } else if (reqType == common::requests::Withdraw) {
-    nlohmann::json j = nlohmann::json::parse(reqMessage);
-    const common::CurrencyTypeValue pair(
-        j["pair"].get<common::CurrencyTypeValue>());
-    return GlobalTradingExchangeClient().withdraw(reqUserId, pair);
-  } else if (reqType == common::requests::Orders) {
-    const TradingExchangeClient::User user =
-        GlobalTradingExchangeClient().getUserById(reqUserId);
-    if (user.orders.empty()) {
-      return "No orders";
+    // Последняя часть отправляется после подтверждения события резервным
+    // сервером.
+    GlobalReplicationPublisher().publish(
+        capture::RecordKind_Request, self->id_, timestamp, data.data(),
+        static_cast<std::uint32_t>(data.size()),
+        [self, reply, newUserId, lastChunk = std::move(lastChunk)]() {
+          boost::asio::post(self->socket_.get_executor(),
+                            [self, reply, newUserId, lastChunk]() mutable {
+                              self->userId_ = newUserId;
+                              self->deliver(reply, std::move(lastChunk),
+                                            true);
+                            });
+        });
+  });
+}
+
+std::string Session::queryHistory(const Command &command) {
+  try {
+    return ::queryHistory(command.type, command.message);
+  } catch (const std::exception &) {
+    return "Invalid request";
+  }
+}
+
+std::uint64_t Session::openReply() {
+  replies_.emplace_back();
+  return firstReply_ + replies_.size() - 1;
+}
+
+void Session::deliver(std::uint64_t reply, std::string chunk, bool last) {
+  if (last) {
+    chunk.push_back(common::messageDelimiter);
+  }
+  Reply &pending = replies_[reply - firstReply_];
+  if (reply == firstReply_) {
+    enqueueResponse(std::move(chunk));
+  } else {
+    GlobalMemoryAccounting().allocated(MemorySubsystem_Sessions,
+                                       chunk.capacity());
+    pending.chunks.push_back(std::move(chunk));
+  }
+  pending.complete = pending.complete || last;
+  while (!replies_.empty() && replies_.front().complete) {
+    replies_.pop_front();
+    ++firstReply_;
+    if (replies_.empty()) {
+      break;
     }
-    nlohmann::json j;
-    std::size_t num = 0;
-    for (const auto &order : user.orders) {
-      ++num;
-      j[std::to_string(num)] = {{"volume",
-                                 {{"currencyType", order.volume.first},
-                                  {"value", order.volume.second}}},
-                                {"price",
-                                 {{"currencyType", order.price.first},
-                                  {"value", order.price.second}}},
-                                {"type", order.type},
-                                {"userID", order.userID},
-                                {"time", order.time}};
+    for (std::string &buffered : replies_.front().chunks) {
+      GlobalMemoryAccounting().released(MemorySubsystem_Sessions,
+                                        buffered.capacity());
+      enqueueResponse(std::move(buffered));
     }
-    j["count"] = num;
-    return j.dump();
-  } else if (reqType == common::requests::Cancel) {
-    const common::Order order = createOrderFromRequest(reqMessage);
-    return GlobalTradingExchangeClient().cancelOrder(order);
+    replies_.front().chunks.clear();
+  }
+  readSignal_.cancel();
+}
+
+void Session::enqueueResponse(std::string response) {
+  if (closed_) {
+    return;
+  }
+  if (outboxSize_ + response.size() > limits::maxOutboxSize) {
+    std::cout << "Slow consumer disconnected" << std::endl;
+    close();
+    return;
+  }
+  outboxSize_ += response.size();
+  // Ответы создаются в потоке биржи, их память учитывается за сессией, пока
+  // они в очереди.
+  GlobalMemoryAccounting().allocated(MemorySubsystem_Sessions,
+                                     response.capacity());
+  outbox_.push_back(std::move(response));
+  writeSignal_.cancel();
+}
+
+void Session::close() {
+  if (closed_) {
+    return;
+  }
+  closed_ = true;
+  boost::system::error_code ignored;
+  socket_.shutdown(tcp::socket::shutdown_both, ignored);
+  socket_.close(ignored);
+  idleTimer_.cancel();
+  writeSignal_.cancel();
+  readSignal_.cancel();
+}
+
+bool Session::consumeUserToken(std::size_t userId) {
+  if (userId == common::unknownUser) {
+    // До входа в систему действует только лимит сессии.
+    return true;
+  }
+  // Сессии одного пользователя могут работать в разных потоках
+  // ввода-вывода.
+  static std::mutex mutex;
+  static std::vector<TokenBucket> userRateLimits;
+  const std::lock_guard<std::mutex> lock(mutex);
+  while (userRateLimits.size() <= userId) {
+    userRateLimits.emplace_back(limits::userRequestRate,
+                                limits::userRequestBurst);
   }
-  return "Unknown request";
+  return userRateLimits[userId].consume();
 }
@@ -1,62 +1,168 @@
 #pragma once
 
 #include "common.h"
+#include "engine_thread.h"
+#include "request_handler.h"
+#include "token_bucket.h"
+#include "tracking_allocator.h"
+
+#include <deque>
+#include <memory>
+#include <vector>
 
 using boost::asio::ip::tcp;
 
 /**
  * @brief  Класс сессии связи между сервером и клиентом.
  * @details Обрабатывает входящие запросы, выполняет соответствующие действия и
- * отправляет ответы клиенту.
+ * отправляет ответы клиенту. Ограничивает частоту запросов и размер очереди
+ * неотправленных ответов, закрывает неактивные соединения.
+ * Чтение запросов, отправка ответов и контроль бездействия выполняются
+ * отдельными сопрограммами в потоке ввода-вывода. Каждая сопрограмма владеет
+ * сессией, сессия удаляется после завершения последней из них.
  */
-class Session {
+class Session : public std::enable_shared_from_this<Session> {
 public:
   /**
    * @brief Конструктор.
-   * @param io_service Сервис для сетевых операций.
+   * @param socket Сокет принятого подключения.
+   * @param engine Поток биржи.
+   */
+  Session(tcp::socket socket, EngineThread &engine);
+
+  /**
+   * @brief Деструктор.
    */
-  Session(boost::asio::io_service &io_service);
+  ~Session();
 
   /**
-   * @brief Получить сокет.
-   * @return Сокет.
+   * @brief Не выдавать новым сессиям номера до заданного включительно.
+   * @param lastId Последний занятый номер.
+   * @details Используется резервным сервером при переходе в роль основного,
+   * чтобы номера новых сессий не совпадали с номерами из журнала.
    */
-  tcp::socket &getSocket();
+  static void reserveIds(std::uint32_t lastId);
 
   /**
    * @brief Запустить работу сессии.
    */
   void startSession();
 
+private:
+  tcp::socket socket_;          //!< Сокет.
+  EngineThread &engine_;        //!< Поток биржи.
+  char data_[limits::buffSize]; //!< Принимаемые данные.
+  //! Принятые данные, ещё не разобранные на запросы.
+  TrackedString<MemorySubsystem_Sessions> received_;
+  //! Очередь неотправленных ответов.
+  std::deque<std::string,
+             TrackingAllocator<std::string, MemorySubsystem_Sessions>>
+      outbox_;
+  std::size_t outboxSize_ = 0; //!< Размер очереди ответов в байтах.
   /**
-   * @brief Обработать входящие данные.
-   * @param error Ошибка чтения данных.
-   * @param bytes_transferred Количество принятых байт.
+   * @brief Ответ на запрос, ожидающий отправки.
    */
-  void handleRead(const boost::system::error_code &error,
-                  size_t bytes_transferred);
+  struct Reply {
+    //! Части ответа, пришедшие раньше окончания предыдущих ответов.
+    std::vector<std::string> chunks;
+    bool complete = false; //!< Пришла ли последняя часть ответа.
+  };
+  //! Незавершённые ответы в порядке поступления запросов.
+  std::deque<Reply, TrackingAllocator<Reply, MemorySubsystem_Sessions>>
+      replies_;
+  std::uint64_t firstReply_ = 0; //!< Номер первого ответа в replies_.
+  //! ID пользователя сессии для лимита частоты в потоке ввода-вывода.
+  std::size_t userId_ = common::unknownUser;
+  bool closed_ = false;        //!< Закрыта ли сессия.
+  TokenBucket rateLimit_; //!< Ограничитель частоты запросов сессии.
+  //! Обработчик запросов, используется только в потоке биржи.
+  RequestHandler requestHandler_;
+  //! Буфер запроса, декодируемого в потоке ввода-вывода.
+  TrackedString<MemorySubsystem_Serialization> decodeBuffer_;
+  std::uint32_t id_;                    //!< Номер сессии.
+  boost::asio::steady_timer idleTimer_; //!< Таймер бездействия.
+  //! Сигнал сопрограмме отправки о новых ответах.
+  boost::asio::steady_timer writeSignal_;
+  //! Сигнал сопрограмме чтения об освобождении очереди ответов.
+  boost::asio::steady_timer readSignal_;
+  //! Время последней активности клиента.
+  std::chrono::steady_clock::time_point lastActivity_;
 
   /**
-   * @brief Обработать отправление данных.
-   * @param error Ошибка чтения данных.
+   * @brief Читать и обрабатывать запросы.
+   * @details Запросы разделяются common::messageDelimiter: одно чтение может
+   * принести несколько запросов или часть запроса, неполный запрос
+   * дочитывается. Сессия с запросом длиннее limits::maxRequestSize
+   * закрывается. Запросы читаются, не дожидаясь ответов биржи на предыдущие.
+   * Пока очередь ответов переполнена или ответа ждут
+   * limits::maxPipelinedRequests запросов, запросы не читаются. После
+   * запросов SignIn и SignUp, а также запросов, не разобранных декодером,
+   * чтение ждёт ответа: от него зависит пользователь для лимита частоты.
    */
-  void handleWrite(const boost::system::error_code &error);
+  boost::asio::awaitable<void> readRequests();
 
-private:
-  tcp::socket socket_;          //!< Сокет.
-  char data_[limits::buffSize]; //!< Принимаемые данные.
+  /**
+   * @brief Отправлять ответы из очереди.
+   */
+  boost::asio::awaitable<void> writeResponses();
+
+  /**
+   * @brief Закрывать соединение после периода бездействия.
+   */
+  boost::asio::awaitable<void> watchIdle();
 
   /**
-   * @brief Создать заявку из запроса.
-   * @param request Запрос.
-   * @return Заявка.
+   * @brief Выполнить запрос в потоке биржи.
+   * @param data Запрос в JSON.
+   * @param reply Номер ответа.
+   * @details Каждая часть ответа передаётся в поток ввода-вывода сразу после
+   * создания. Последняя часть приходит после подтверждения события
+   * резервным сервером.
    */
-  common::Order createOrderFromRequest(const std::string &request) const;
+  void execute(std::string data, std::uint64_t reply);
 
   /**
-   * @brief Создать ответ на запрос.
-   * @param json Данные в JSON формате.
+   * @brief Ответить на запрос истории сделок в потоке ввода-вывода.
+   * @param command Декодированный запрос Trades или Ohlcv.
    * @return Ответ.
+   * @details Запросы истории только читают ленту сделок и не ждут очереди
+   * потока биржи.
+   */
+  static std::string queryHistory(const Command &command);
+
+  /**
+   * @brief Начать ответ на очередной запрос.
+   * @return Номер ответа.
+   */
+  std::uint64_t openReply();
+
+  /**
+   * @brief Передать часть ответа на отправку.
+   * @param reply Номер ответа.
+   * @param chunk Часть ответа.
+   * @param last Является ли часть последней.
+   * @details Ответы отправляются в порядке запросов: части ответа, перед
+   * которым есть незавершённые, хранятся до их окончания. После последней
+   * части ответа отправляется common::messageDelimiter.
+   */
+  void deliver(std::uint64_t reply, std::string chunk, bool last);
+
+  /**
+   * @brief Поставить ответ в очередь на отправку.
+   * @param response Ответ.
+   * @details Клиент, не успевающий принимать ответы, отключается.
+   */
+  void enqueueResponse(std::string response);
+
+  /**
+   * @brief Закрыть соединение.
+   */
+  void close();
+
+  /**
+   * @brief Проверить лимит частоты запросов пользователя.
+   * @param userId ID пользователя.
+   * @return true-запрос разрешён, false-лимит превышен.
    */
-  std::string createResponse(const nlohmann::json &json);
-};
\ No newline at end of file
+  static bool consumeUserToken(std::size_t userId);
+};
@@ -0,0 +1,301 @@
+#pragma once
+
+#include "common.h"
+#include "page_memory.h"
+#include "tracking_allocator.h"
+
+#include <mutex>
+#include <vector>
+
+/**
+ * @brief Предварительное заполнение пулов сессий.
+ * @details SessionAllocator ведёт пул для каждого типа выделяемых блоков
+ * (для std::allocate_shared - блока управления вместе с сессией). Типы
+ * регистрируются при запуске программы, поэтому пулы потока можно
+ * заполнить до первого подключения, не называя эти типы. Память заранее
+ * выделенных блоков существует до завершения процесса: сессия может
+ * освобождаться в другом потоке и после завершения своего. Каждая область
+ * помнит пул-владелец: блоки, освобождённые в другом потоке, копятся в
+ * области и забираются владельцем, а не оседают в пуле чужого потока.
+ */
+class SessionPools {
+public:
+  //! Функция заполнения пула одного типа блоков в текущем потоке.
+  using Reserver = void (*)(std::size_t count, bool hugePages);
+
+  /**
+   * @brief Заполнить пулы текущего потока.
+   * @param count Количество блоков каждого типа.
+   * @param hugePages Выделять память большими страницами.
+   */
+  static void reserve(std::size_t count, bool hugePages) {
+    for (const Reserver reserver : reservers()) {
+      reserver(count, hugePages);
+    }
+  }
+
+  /**
+   * @brief Зарегистрировать тип блоков.
+   * @param reserver Функция заполнения пула.
+   * @return true (значение для инициализации статического члена).
+   */
+  static bool add(Reserver reserver) {
+    reservers().push_back(reserver);
+    return true;
+  }
+
+  /**
+   * @brief Выделить область для заранее выделенных блоков.
+   * @param size Размер области.
+   * @param hugePages Выделять большими страницами.
+   * @param owner Пул, которому принадлежат блоки области.
+   * @return Начало области.
+   */
+  static char *allocateArea(std::size_t size, bool hugePages,
+                            const void *owner) {
+    const std::lock_guard<std::mutex> lock(areasMutex());
+    areas().push_back({PageMemory(size, hugePages), owner, {}});
+    GlobalMemoryAccounting().allocated(MemorySubsystem_Sessions,
+                                       areas().back().memory.size());
+    return static_cast<char *>(areas().back().memory.data());
+  }
+
+  /**
+   * @brief Найти пул-владелец блока.
+   * @param block Блок.
+   * @return Пул, заполненный блоком, или nullptr, если блок выделен
+   * распределителем.
+   */
+  static const void *findOwner(const void *block) {
+    const std::lock_guard<std::mutex> lock(areasMutex());
+    const Area *area = findArea(block);
+    return area != nullptr ? area->owner : nullptr;
+  }
+
+  /**
+   * @brief Вернуть заранее выделенный блок пулу-владельцу из другого
+   * потока.
+   * @param block Блок.
+   */
+  static void giveBack(void *block) {
+    const std::lock_guard<std::mutex> lock(areasMutex());
+    findArea(block)->returned.push_back(block);
+  }
+
+  /**
+   * @brief Забрать блоки, возвращённые пулу из других потоков.
+   * @param owner Пул.
+   * @param take Обработчик блока.
+   */
+  template <typename Take> static void takeReturned(const void *owner,
+                                                    Take &&take) {
+    const std::lock_guard<std::mutex> lock(areasMutex());
+    for (Area &area : areas()) {
+      if (area.owner == owner) {
+        for (void *block : area.returned) {
+          take(block);
+        }
+        area.returned.clear();
+      }
+    }
+  }
+
+private:
+  /**
+   * @brief Область заранее выделенных блоков.
+   */
+  struct Area {
+    PageMemory memory; //!< Память блоков.
+    const void *owner; //!< Пул, заполненный блоками области.
+    //! Блоки, освобождённые в других потоках и ждущие владельца.
+    std::vector<void *> returned;
+  };
+
+  /**
+   * @brief Найти область блока (под мьютексом областей).
+   * @param block Блок.
+   * @return Область или nullptr, если блок выделен распределителем.
+   */
+  static Area *findArea(const void *block) {
+    const char *address = static_cast<const char *>(block);
+    for (Area &area : areas()) {
+      const char *begin = static_cast<const char *>(area.memory.data());
+      if ((address >= begin) && (address < begin + area.memory.size())) {
+        return &area;
+      }
+    }
+    return nullptr;
+  }
+
+  /**
+   * @brief Получить области заранее выделенных блоков.
+   */
+  static std::vector<Area> &areas() {
+    static std::vector<Area> instance;
+    return instance;
+  }
+
+  /**
+   * @brief Получить мьютекс областей (пулы заполняются в разных потоках).
+   */
+  static std::mutex &areasMutex() {
+    static std::mutex instance;
+    return instance;
+  }
+
+  /**
+   * @brief Получить функции заполнения зарегистрированных пулов.
+   */
+  static std::vector<Reserver> &reservers() {
+    static std::vector<Reserver> instance;
+    return instance;
+  }
+};
+
+/**
+ * @brief Распределитель памяти сессий с пулом в каждом потоке.
+ * @tparam T Тип элементов.
+ * @details Освобождённые блоки из одного элемента сохраняются в пуле
+ * текущего потока и выдаются следующим сессиям этого потока, поэтому приём
+ * подключения не обращается к общей куче и не синхронизируется с другими
+ * потоками ввода-вывода. Блоки в пуле учитываются как память сессий. Пул
+ * можно заранее заполнить блоками из одной области памяти
+ * (SessionPools::reserve): такие блоки, освобождённые в другом потоке,
+ * возвращаются пулу, который ими заполнен. Потоки, которые только
+ * освобождают сессии (например, поток биржи), блоков не копят. Подходит для
+ * std::allocate_shared.
+ */
+template <typename T> class SessionAllocator {
+public:
+  using value_type = T; //!< Тип элементов.
+
+  SessionAllocator() = default;
+
+  /**
+   * @brief Конструктор из распределителя другого типа элементов.
+   */
+  template <typename U> SessionAllocator(const SessionAllocator<U> &) {}
+
+  /**
+   * @brief Выделить память.
+   * @param count Количество элементов.
+   * @return Память.
+   */
+  T *allocate(std::size_t count) {
+    static_cast<void>(registered_);
+    Pool &pool = localPool();
+    pool.allocates = true;
+    std::vector<T *> &blocks = pool.blocks;
+    if ((count == 1) && blocks.empty() && (pool.reserved != 0)) {
+      SessionPools::takeReturned(&pool, [&blocks](void *memory) {
+        blocks.push_back(static_cast<T *>(memory));
+      });
+    }
+    if ((count == 1) && !blocks.empty()) {
+      T *memory = blocks.back();
+      blocks.pop_back();
+      return memory;
+    }
+    return Upstream().allocate(count);
+  }
+
+  /**
+   * @brief Освободить память.
+   * @param memory Память.
+   * @param count Количество элементов.
+   */
+  void deallocate(T *memory, std::size_t count) {
+    Pool &pool = localPool();
+    if (count == 1) {
+      // Заранее выделенные блоки всегда возвращаются в пул-владелец.
+      const void *owner = SessionPools::findOwner(memory);
+      if (owner == &pool) {
+        pool.blocks.push_back(memory);
+        return;
+      }
+      if (owner != nullptr) {
+        SessionPools::giveBack(memory);
+        return;
+      }
+      if (pool.allocates &&
+          (pool.blocks.size() < limits::sessionPoolSize + pool.reserved)) {
+        pool.blocks.push_back(memory);
+        return;
+      }
+    }
+    Upstream().deallocate(memory, count);
+  }
+
+  /**
+   * @brief Распределители без состояния взаимозаменяемы.
+   */
+  template <typename U> bool operator==(const SessionAllocator<U> &) const {
+    return true;
+  }
+
+  /**
+   * @brief Распределители без состояния взаимозаменяемы.
+   */
+  template <typename U> bool operator!=(const SessionAllocator<U> &) const {
+    return false;
+  }
+
+private:
+  //! Распределитель, из которого берутся блоки.
+  using Upstream = TrackingAllocator<T, MemorySubsystem_Sessions>;
+
+  /**
+   * @brief Пул свободных блоков потока.
+   */
+  struct Pool {
+    Pool() { blocks.reserve(limits::sessionPoolSize); }
+
+    ~Pool() {
+      for (T *memory : blocks) {
+        if (SessionPools::findOwner(memory) == nullptr) {
+          Upstream().deallocate(memory, 1);
+        }
+      }
+    }
+
+    std::vector<T *> blocks;  //!< Свободные блоки.
+    std::size_t reserved = 0; //!< Количество заранее выделенных блоков.
+    bool allocates = false;   //!< Поток выделял блоки.
+  };
+
+  /**
+   * @brief Получить пул текущего потока.
+   * @return Пул.
+   */
+  static Pool &localPool() {
+    thread_local Pool pool;
+    return pool;
+  }
+
+  /**
+   * @brief Заполнить пул текущего потока.
+   * @param count Требуемое количество свободных блоков.
+   * @param hugePages Выделять память большими страницами.
+   */
+  static void reserve(std::size_t count, bool hugePages) {
+    Pool &pool = localPool();
+    if (count <= pool.blocks.size()) {
+      return;
+    }
+    count -= pool.blocks.size();
+    // Блоки выравниваются по строке кэша: соседние сессии не делят строк.
+    constexpr std::size_t blockSize = (sizeof(T) + 63) / 64 * 64;
+    static_assert(alignof(T) <= 64, "Session block alignment exceeds 64");
+    char *area =
+        SessionPools::allocateArea(count * blockSize, hugePages, &pool);
+    pool.blocks.reserve(limits::sessionPoolSize + pool.reserved + count);
+    // Первыми выдаются блоки из начала области.
+    for (std::size_t i = count; i > 0; --i) {
+      pool.blocks.push_back(reinterpret_cast<T *>(area + (i - 1) * blockSize));
+    }
+    pool.reserved += count;
+  }
+
+  //! Тип блоков зарегистрирован в SessionPools.
+  static inline const bool registered_ = SessionPools::add(&reserve);
+};
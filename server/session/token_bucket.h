@@ -0,0 +1,44 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+/**
+ * @brief Ограничитель частоты запросов по алгоритму "token bucket".
+ * @details Корзина пополняется с постоянной скоростью до заданной ёмкости,
+ * каждый запрос забирает один токен.
+ */
+class TokenBucket {
+public:
+  /**
+   * @brief Конструктор.
+   * @param rate Скорость пополнения (токенов в секунду).
+   * @param burst Ёмкость корзины.
+   */
+  TokenBucket(double rate, double burst)
+      : rate_(rate), burst_(burst), tokens_(burst),
+        lastRefill_(std::chrono::steady_clock::now()) {}
+
+  /**
+   * @brief Забрать токен.
+   * @return true-токен получен, false-лимит превышен.
+   */
+  bool consume() {
+    const auto now = std::chrono::steady_clock::now();
+    const std::chrono::duration<double> elapsed = now - lastRefill_;
+    lastRefill_ = now;
+    tokens_ = std::min(burst_, tokens_ + elapsed.count() * rate_);
+    if (tokens_ < 1.) {
+      return false;
+    }
+    tokens_ -= 1.;
+    return true;
+  }
+
+private:
+  double rate_;   //!< Скорость пополнения (токенов в секунду).
+  double burst_;  //!< Ёмкость корзины.
+  double tokens_; //!< Текущее количество токенов.
+  //! Время последнего пополнения.
+  std::chrono::steady_clock::time_point lastRefill_;
+};
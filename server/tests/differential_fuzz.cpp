@@ -0,0 +1,63 @@
+#include "differential_harness.h"
+
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+//! Наибольшее количество команд одного входа.
+constexpr std::size_t maxSteps = 10000;
+
+} // namespace
+
+/**
+ * @brief Точка входа libFuzzer.
+ * @param data Вход: байты решений генератора команд.
+ * @param size Размер входа.
+ * @return 0.
+ * @details При расхождении биржи с моделью процесс аварийно завершается,
+ * и фаззер сохраняет вход.
+ */
+extern "C" int LLVMFuzzerTestOneInput(const std::uint8_t *data,
+                                      std::size_t size) {
+  static const bool silenced = [] {
+    DifferentialHarness::silenceExchangeOutput();
+    return true;
+  }();
+  (void)silenced;
+  DifferentialHarness harness;
+  Entropy entropy(data, size);
+  while (!entropy.exhausted() && (harness.steps() < maxSteps)) {
+    if (!harness.step(entropy)) {
+      std::abort();
+    }
+  }
+  return 0;
+}
+
+#ifdef STANDALONE_FUZZ_DRIVER
+/**
+ * @brief Прогнать входы без libFuzzer.
+ * @details Аргументы - файлы входов (например, сохранённые фаззером);
+ * без аргументов вход читается из стандартного ввода.
+ */
+int main(int argc, char *argv[]) {
+  const auto run = [](std::istream &input) {
+    const std::vector<char> bytes(std::istreambuf_iterator<char>(input), {});
+    LLVMFuzzerTestOneInput(
+        reinterpret_cast<const std::uint8_t *>(bytes.data()), bytes.size());
+  };
+  if (argc < 2) {
+    run(std::cin);
+  }
+  for (int i = 1; i < argc; ++i) {
+    std::ifstream input(argv[i], std::ios::binary);
+    if (!input) {
+      std::cerr << "Cannot read " << argv[i] << std::endl;
+      return 1;
+    }
+    run(input);
+  }
+  return 0;
+}
+#endif
@@ -0,0 +1,353 @@
+#include "differential_harness.h"
+
+#include <cmath>
+#include <sstream>
+#include <streambuf>
+
+namespace {
+
+//! Начало отсчёта времени: за час до начала суток (UTC).
+constexpr std::int64_t startTimestamp = (1792368000ll - 3600) * 1000000000ll;
+//! Одна секунда (нс).
+constexpr std::int64_t second = 1000000000ll;
+//! Одни сутки (нс).
+constexpr std::int64_t day = 86400 * second;
+//! Цены обратной пары, обратные к которым точно представимы в float.
+constexpr float inversePrices[] = {0.0625f, 0.125f, 0.25f, 0.5f};
+
+/**
+ * @brief Буфер потока, отбрасывающий вывод.
+ */
+class NullBuffer : public std::streambuf {
+protected:
+  int overflow(int c) override { return c; }
+};
+
+/**
+ * @brief Описать заявку для сообщения о расхождении.
+ * @param order Заявка.
+ * @return Описание.
+ */
+std::string describe(const common::Order &order) {
+  std::ostringstream stream;
+  stream << (order.type == common::OrderType_Buy    ? "Buy"
+             : order.type == common::OrderType_Sell ? "Sell"
+                                                    : "None")
+         << " instrument " << static_cast<int>(order.instrument) << " user "
+         << order.userID
+         << " volume " << order.volume << " price " << order.price
+         << " kind " << order.kind << " stop " << order.stopPrice
+         << " peak " << order.peak << " tif " << order.timeInForce
+         << " expire " << order.expireTime << " at " << order.timestamp;
+  return stream.str();
+}
+
+/**
+ * @brief Сравнить число биржи с точным числом модели.
+ * @param actual Число биржи (float).
+ * @param expected Число модели.
+ * @return true-отличаются не больше погрешности float, false-нет.
+ */
+bool nearlyEqual(double actual, double expected) {
+  return std::fabs(actual - expected) <= 1e-3 + 1e-6 * std::fabs(expected);
+}
+
+/**
+ * @brief Сравнить состояние биржи с состоянием модели.
+ * @param actual Состояние биржи.
+ * @param expected Состояние модели.
+ * @return true-совпадают с точностью до погрешности чисел, false-нет.
+ */
+bool sameState(const nlohmann::json &actual, const nlohmann::json &expected) {
+  if (actual.is_number_float() || expected.is_number_float()) {
+    return actual.is_number() && expected.is_number() &&
+           nearlyEqual(actual.get<double>(), expected.get<double>());
+  }
+  if (actual.is_array() && expected.is_array()) {
+    return (actual.size() == expected.size()) &&
+           std::equal(actual.begin(), actual.end(), expected.begin(),
+                      sameState);
+  }
+  if (actual.is_object() && expected.is_object()) {
+    if (actual.size() != expected.size()) {
+      return false;
+    }
+    for (auto it = expected.begin(); it != expected.end(); ++it) {
+      if (!actual.contains(it.key()) ||
+          !sameState(actual.at(it.key()), it.value())) {
+        return false;
+      }
+    }
+    return true;
+  }
+  return actual == expected;
+}
+
+/**
+ * @brief Сравнить сделки.
+ * @param actual Сделка биржи.
+ * @param expected Сделка модели.
+ * @return true-совпадают, false-нет.
+ */
+bool sameTrade(const Trade &actual, const Trade &expected) {
+  return (actual.timestamp == expected.timestamp) &&
+         (actual.instrument == expected.instrument) &&
+         nearlyEqual(actual.price, expected.price) &&
+         nearlyEqual(actual.volume, expected.volume) &&
+         (actual.aggressor == expected.aggressor);
+}
+
+/**
+ * @brief Описать сделки для сообщения о расхождении.
+ * @param trades Сделки.
+ * @return Описание.
+ */
+std::string describe(const std::vector<Trade> &trades) {
+  std::ostringstream stream;
+  for (const Trade &trade : trades) {
+    stream << "[" << static_cast<int>(trade.instrument) << " " << trade.volume
+           << " at " << trade.price << " aggressor " << trade.aggressor
+           << " time " << trade.timestamp << "]";
+  }
+  return stream.str();
+}
+
+} // namespace
+
+Entropy::Entropy(std::uint64_t seed) : random_(seed) {}
+
+Entropy::Entropy(const std::uint8_t *data, std::size_t size)
+    : data_(data), size_(size), fromData_(true) {}
+
+std::uint32_t Entropy::next(std::uint32_t bound) {
+  if (!fromData_) {
+    return static_cast<std::uint32_t>(random_() % bound);
+  }
+  std::uint64_t value = 0;
+  for (std::uint64_t range = 1; range < bound; range <<= 8) {
+    if (size_ == 0) {
+      exhausted_ = true;
+      return 0;
+    }
+    value = (value << 8) | *data_++;
+    --size_;
+  }
+  return static_cast<std::uint32_t>(value % bound);
+}
+
+DifferentialHarness::DifferentialHarness() : timestamp_(startTimestamp) {
+  for (const std::string name : {"alice", "bob", "carol"}) {
+    const std::size_t userId = exchange_.registerNewUser(name);
+    reference_.registerNewUser(name);
+    exchange_.deposit(userId, common::currency::Currency_RU, 1000.f);
+    reference_.deposit(userId, common::currency::Currency_RU, 1000.f);
+    exchange_.deposit(userId, common::currency::Currency_USD, 100.f);
+    reference_.deposit(userId, common::currency::Currency_USD, 100.f);
+  }
+}
+
+void DifferentialHarness::silenceExchangeOutput() {
+  static NullBuffer nullBuffer;
+  std::cout.rdbuf(&nullBuffer);
+}
+
+bool DifferentialHarness::step(Entropy &entropy) {
+  ++steps_;
+  // Время идёт вперёд мелкими шагами, изредка - до границы секунды или
+  // суток, чтобы сроки действия заявок истекали на границах тактов.
+  const std::uint32_t timeStep = entropy.next(100);
+  if (timeStep < 70) {
+    timestamp_ += entropy.next(50) * 1000000ll;
+  } else if (timeStep < 90) {
+    timestamp_ += entropy.next(3000) * 1000000ll;
+  } else if (timeStep < 95) {
+    timestamp_ = (timestamp_ / second + 1) * second;
+  } else if (timeStep < 99) {
+    timestamp_ += entropy.next(100) * second;
+  } else {
+    timestamp_ = (timestamp_ / day + 1) * day - entropy.next(2) * second;
+  }
+
+  const std::uint32_t command = entropy.next(100);
+  if (command < 45) {
+    const common::Order order = makeOrder(entropy);
+    return compare(describe(order), exchange_.registerOrder(order),
+                   reference_.registerOrder(order), false);
+  }
+  if (command < 55) {
+    common::Order order;
+    if (entropy.next(10) != 0) {
+      std::tie(order.userID, order.id) =
+          reference_.findOrder(entropy.next(1000));
+    }
+    if ((order.userID == common::unknownUser) || (entropy.next(10) == 0)) {
+      order.userID = pickUser(entropy);
+      order.id = entropy.next(
+          static_cast<std::uint32_t>(reference_.lastOrderId() + 2));
+    }
+    return compare("Cancel #" + std::to_string(order.id) + " user " +
+                       std::to_string(order.userID),
+                   exchange_.cancelOrder(order), reference_.cancelOrder(order),
+                   false);
+  }
+  if (command < 70) {
+    const bool isDeposit = command < 65;
+    const std::size_t userId = pickUser(entropy);
+    constexpr auto currencyCount =
+        static_cast<std::uint32_t>(common::currency::CurrencyCount);
+    // Изредка валюта неизвестна.
+    const auto currency = static_cast<common::currency::CurrencyId>(
+        entropy.next(40) == 0 ? currencyCount : entropy.next(currencyCount));
+    const float value = static_cast<float>(
+        entropy.next(20) == 0 ? 0 : 1 + entropy.next(isDeposit ? 2000 : 500));
+    const std::string description =
+        (isDeposit ? "Deposit " : "Withdraw ") + std::to_string(value) +
+        " currency " + std::to_string(currency) + " user " +
+        std::to_string(userId);
+    if (isDeposit) {
+      return compare(description, exchange_.deposit(userId, currency, value),
+                     reference_.deposit(userId, currency, value), false);
+    }
+    return compare(description, exchange_.withdraw(userId, currency, value),
+                   reference_.withdraw(userId, currency, value), false);
+  }
+  if (command < 95) {
+    exchange_.process(timestamp_);
+    reference_.process(timestamp_);
+    return compare("Process at " + std::to_string(timestamp_), "", "", true);
+  }
+  // Имя иногда совпадает с зарегистрированным.
+  const std::string name =
+      "user" + std::to_string(entropy.next(
+                   static_cast<std::uint32_t>(reference_.userCount() + 2)));
+  return compare("SignUp " + name,
+                 std::to_string(exchange_.registerNewUser(name)),
+                 std::to_string(reference_.registerNewUser(name)), false);
+}
+
+common::Order DifferentialHarness::makeOrder(Entropy &entropy) {
+  common::Order order;
+  order.userID = pickUser(entropy);
+  order.timestamp = timestamp_;
+  const bool inverse = entropy.next(5) == 0;
+  order.instrument = entropy.next(100) == 0
+                         ? common::currency::InstrumentCount
+                     : inverse ? common::currency::Instrument_RU_USD
+                               : common::currency::Instrument_USD_RU;
+  order.type = entropy.next(50) == 0    ? common::OrderType_None
+               : entropy.next(2) == 0 ? common::OrderType_Buy
+                                      : common::OrderType_Sell;
+  const std::uint32_t kind = entropy.next(100);
+  // Цена исполнения стоп-заявки по рынку обратной пары не имеет конечной
+  // обратной, такие заявки подаются только по прямой паре.
+  order.kind = kind < 55                ? common::OrderKind_Limit
+               : kind < 70              ? common::OrderKind_Iceberg
+               : (kind < 85) && !inverse ? common::OrderKind_Stop
+                                         : common::OrderKind_StopLimit;
+  const std::uint32_t timeInForce = entropy.next(100);
+  order.timeInForce = timeInForce < 40   ? common::TimeInForce_GTC
+                      : timeInForce < 60 ? common::TimeInForce_IOC
+                      : timeInForce < 80 ? common::TimeInForce_FOK
+                      : timeInForce < 90 ? common::TimeInForce_DAY
+                                         : common::TimeInForce_GTD;
+  // Объём обратной пары кратен 16 рублям: при любой цене из inversePrices
+  // объём в долларах - целое число.
+  const float unit = inverse ? 16.f : 1.f;
+  const auto price = [&entropy, inverse]() {
+    if (inverse) {
+      return inversePrices[entropy.next(std::size(inversePrices))];
+    }
+    return static_cast<float>(2 + entropy.next(15)) +
+           (entropy.next(50) == 0 ? 0.005f : 0.f);
+  };
+  order.price = price();
+  order.volume = entropy.next(50) == 0
+                     ? 0.f
+                     : unit * static_cast<float>(1 + entropy.next(20));
+  if ((order.kind == common::OrderKind_Stop) ||
+      (order.kind == common::OrderKind_StopLimit)) {
+    order.stopPrice = price();
+  }
+  if (order.kind == common::OrderKind_Iceberg) {
+    order.peak =
+        unit * static_cast<float>(
+                   1 + entropy.next(static_cast<std::uint32_t>(
+                           order.volume / unit + 1)));
+  }
+  if (order.timeInForce == common::TimeInForce_GTD) {
+    const std::uint32_t horizon = entropy.next(20);
+    order.expireTime =
+        horizon == 0  ? timestamp_
+        : horizon < 3 ? timestamp_ + entropy.next(5000) * second
+                      : timestamp_ + entropy.next(100) * second +
+                            (entropy.next(2) == 0 ? 0
+                                                  : entropy.next(second));
+  }
+  return order;
+}
+
+std::size_t DifferentialHarness::pickUser(Entropy &entropy) {
+  const std::uint32_t users =
+      static_cast<std::uint32_t>(reference_.userCount());
+  return entropy.next(50) == 0 ? users : entropy.next(users);
+}
+
+bool DifferentialHarness::compare(const std::string &command,
+                                  const std::string &actual,
+                                  const std::string &expected, bool matched) {
+  bool passed = true;
+  const auto fail = [this, &command, &passed](const std::string &what) {
+    if (passed) {
+      std::cerr << "Step " << steps_ << ": " << command << std::endl;
+    }
+    std::cerr << "  " << what << std::endl;
+    passed = false;
+  };
+  if (actual != expected) {
+    fail("response '" + actual + "', expected '" + expected + "'");
+  }
+
+  // Лента биржи выдаёт последние сделки по каждому инструменту отдельно.
+  const std::vector<Trade> expectedTrades = reference_.takeTrades();
+  const std::size_t newTrades = exchange_.getTradeStore().size() - tradesSeen_;
+  tradesSeen_ += newTrades;
+  if (newTrades != expectedTrades.size()) {
+    fail(std::to_string(newTrades) + " trades, expected " +
+         std::to_string(expectedTrades.size()) + " " +
+         describe(expectedTrades));
+  } else {
+    for (const common::currency::Instrument &instrument :
+         common::currency::instruments) {
+      std::vector<Trade> expected;
+      std::copy_if(expectedTrades.begin(), expectedTrades.end(),
+                   std::back_inserter(expected),
+                   [&instrument](const Trade &trade) {
+                     return trade.instrument == instrument.id;
+                   });
+      if (expected.empty()) {
+        continue;
+      }
+      std::vector<Trade> actual = exchange_.getTradeStore().getRecentTrades(
+          instrument.id, expected.size());
+      std::reverse(actual.begin(), actual.end());
+      if ((actual.size() != expected.size()) ||
+          !std::equal(actual.begin(), actual.end(), expected.begin(),
+                      sameTrade)) {
+        fail("trades " + describe(actual) + ", expected " +
+             describe(expected));
+      }
+    }
+  }
+
+  const nlohmann::json actualState =
+      nlohmann::json::parse(exchange_.dumpState());
+  const nlohmann::json expectedState = reference_.dumpState();
+  if (!sameState(actualState, expectedState)) {
+    fail("state " + actualState.dump() + "\n  expected " +
+         expectedState.dump());
+  }
+  for (const std::string &error : exchange_.checkConsistency(matched)) {
+    fail(error);
+  }
+  return passed;
+}
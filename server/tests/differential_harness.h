@@ -0,0 +1,117 @@
+#pragma once
+
+#include "reference_exchange.h"
+#include "trading_exchange_client.h"
+
+#include <random>
+
+/**
+ * @brief Источник решений генератора команд.
+ * @details Решения берутся из генератора псевдослучайных чисел либо из
+ * байтов входа фаззера: тогда мутации входа меняют поток команд. Исчерпанный
+ * вход даёт нули.
+ */
+class Entropy {
+public:
+  /**
+   * @brief Конструктор источника псевдослучайных решений.
+   * @param seed Начальное значение генератора.
+   */
+  explicit Entropy(std::uint64_t seed);
+
+  /**
+   * @brief Конструктор источника решений из входа фаззера.
+   * @param data Вход.
+   * @param size Размер входа.
+   */
+  Entropy(const std::uint8_t *data, std::size_t size);
+
+  /**
+   * @brief Получить очередное решение.
+   * @param bound Количество вариантов (больше нуля).
+   * @return Число от 0 до bound - 1.
+   */
+  std::uint32_t next(std::uint32_t bound);
+
+  /**
+   * @brief Исчерпан ли вход фаззера.
+   */
+  bool exhausted() const { return exhausted_; }
+
+private:
+  std::mt19937_64 random_;             //!< Генератор.
+  const std::uint8_t *data_ = nullptr; //!< Вход фаззера.
+  std::size_t size_ = 0;               //!< Оставшийся размер входа.
+  bool fromData_ = false;              //!< Решения берутся из входа.
+  bool exhausted_ = false;             //!< Вход исчерпан.
+};
+
+/**
+ * @brief Дифференциальная проверка биржи по эталонной модели.
+ * @details Каждый шаг генерирует случайную команду (заявку любого вида и
+ * срока действия, отмену, внесение или снятие средств, нового пользователя
+ * или такт обработки "стаканов"), выполняет её на TradingExchangeClient и
+ * на ReferenceExchange и сравнивает ответы, совершённые сделки, "стаканы" и
+ * балансы, а также проверяет согласованность структур биржи. Числа биржи
+ * сравниваются с точными числами модели с допуском на погрешность float.
+ * Цены и объёмы кратны десятитысячным долям, цены обратной пары имеют
+ * конечные обратные, стоп-заявки по рынку подаются только по прямой паре.
+ */
+class DifferentialHarness {
+public:
+  /**
+   * @brief Конструктор.
+   * @details Регистрирует нескольких пользователей со средствами.
+   */
+  DifferentialHarness();
+
+  /**
+   * @brief Выполнить очередную случайную команду и сравнить результаты.
+   * @param entropy Источник решений.
+   * @return true-результаты совпали, false-нет (расхождение выводится в
+   * std::cerr).
+   */
+  bool step(Entropy &entropy);
+
+  /**
+   * @brief Количество выполненных шагов.
+   */
+  std::size_t steps() const { return steps_; }
+
+  /**
+   * @brief Отбрасывать вывод биржи в std::cout.
+   */
+  static void silenceExchangeOutput();
+
+private:
+  /**
+   * @brief Сгенерировать заявку.
+   * @param entropy Источник решений.
+   * @return Заявка.
+   */
+  common::Order makeOrder(Entropy &entropy);
+
+  /**
+   * @brief Выбрать пользователя.
+   * @param entropy Источник решений.
+   * @return ID пользователя, изредка - незарегистрированного.
+   */
+  std::size_t pickUser(Entropy &entropy);
+
+  /**
+   * @brief Сравнить ответы, сделки и состояния после команды.
+   * @param command Описание команды.
+   * @param actual Ответ биржи.
+   * @param expected Ответ модели.
+   * @param matched Команда совмещала все "стаканы".
+   * @return true-совпадают, false-нет.
+   */
+  bool compare(const std::string &command, const std::string &actual,
+               const std::string &expected, bool matched);
+
+  TradingExchangeClient exchange_; //!< Проверяемая биржа.
+  ReferenceExchange reference_;    //!< Эталонная модель.
+  std::int64_t timestamp_;         //!< Текущее время (нс с начала эпохи).
+  std::size_t tradesSeen_ = 0;     //!< Сделок биржи проверено.
+  std::size_t steps_ = 0;          //!< Выполнено шагов.
+};
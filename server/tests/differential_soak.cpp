@@ -0,0 +1,116 @@
+#include "differential_harness.h"
+
+namespace {
+
+//! Подсказка по аргументам.
+const std::string usage =
+    "Usage: differential_soak [duration-seconds] [first-seed] [steps-per-seed]";
+
+/**
+ * @brief Параметры прогона.
+ */
+struct SoakOptions {
+  std::uint64_t duration = 0; //!< Длительность (с), 0 - до расхождения.
+  //! Первое начальное значение генератора.
+  std::uint64_t seed = static_cast<std::uint64_t>(common::currentTimestamp());
+  std::uint64_t stepsPerSeed = 20000; //!< Количество команд в прогоне.
+};
+
+/**
+ * @brief Разобрать неотрицательное целое число.
+ * @param argument Аргумент.
+ * @return Число.
+ * @details Бросает std::invalid_argument с подсказкой, если аргумент - не
+ * число.
+ */
+std::uint64_t parseNumber(const std::string &argument) {
+  std::size_t parsed = 0;
+  std::uint64_t value = 0;
+  try {
+    value = std::stoull(argument, &parsed);
+  } catch (const std::exception &) {
+    parsed = 0;
+  }
+  if ((parsed == 0) || (parsed != argument.size()) ||
+      (argument.front() == '-')) {
+    throw std::invalid_argument("Invalid argument " + argument + "\n" +
+                                usage);
+  }
+  return value;
+}
+
+/**
+ * @brief Разобрать параметры командной строки.
+ * @param argc Количество аргументов.
+ * @param argv Аргументы.
+ * @return Параметры прогона.
+ */
+SoakOptions parseOptions(int argc, char *argv[]) {
+  if (argc > 4) {
+    throw std::invalid_argument(usage);
+  }
+  SoakOptions options;
+  std::uint64_t *const values[] = {&options.duration, &options.seed,
+                                   &options.stepsPerSeed};
+  for (int i = 1; i < argc; ++i) {
+    *values[i - 1] = parseNumber(argv[i]);
+  }
+  if (options.stepsPerSeed == 0) {
+    throw std::invalid_argument("Steps per seed must be positive\n" + usage);
+  }
+  return options;
+}
+
+} // namespace
+
+/**
+ * @brief Длительно сравнивать биржу с эталонной моделью.
+ * @details Аргументы: длительность в секундах (0 - до первого расхождения,
+ * по умолчанию 0), первое начальное значение генератора (по умолчанию -
+ * текущее время), количество команд в прогоне (20000). Прогоны выполняются
+ * с последовательными начальными значениями; при расхождении выводится
+ * начальное значение, с которым его можно воспроизвести.
+ */
+int main(int argc, char *argv[]) {
+  if ((argc > 1) && ((std::string(argv[1]) == "--help") ||
+                     (std::string(argv[1]) == "-h"))) {
+    std::cout << usage << std::endl;
+    return 0;
+  }
+  SoakOptions options;
+  try {
+    options = parseOptions(argc, argv);
+  } catch (const std::invalid_argument &e) {
+    std::cerr << e.what() << std::endl;
+    return 2;
+  }
+  try {
+    DifferentialHarness::silenceExchangeOutput();
+    const auto start = std::chrono::steady_clock::now();
+    std::size_t totalSteps = 0;
+    for (std::uint64_t seed = options.seed;; ++seed) {
+      DifferentialHarness harness;
+      Entropy entropy(seed);
+      while (harness.steps() < options.stepsPerSeed) {
+        if (!harness.step(entropy)) {
+          std::cerr << "Mismatch with seed " << seed << " after "
+                    << totalSteps + harness.steps() << " steps" << std::endl;
+          return 1;
+        }
+      }
+      totalSteps += harness.steps();
+      const std::chrono::duration<double> elapsed =
+          std::chrono::steady_clock::now() - start;
+      std::cerr << "Seed " << seed << " passed, " << totalSteps
+                << " steps in " << elapsed.count() << " s" << std::endl;
+      if ((options.duration > 0) &&
+          (elapsed.count() >= double(options.duration))) {
+        break;
+      }
+    }
+  } catch (std::exception &e) {
+    std::cerr << "Soak failed: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}
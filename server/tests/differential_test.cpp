@@ -0,0 +1,31 @@
+#include "differential_harness.h"
+
+namespace {
+
+//! Количество прогонов с разными начальными значениями генератора.
+constexpr std::uint64_t seeds = 4;
+//! Количество команд в прогоне.
+constexpr std::size_t stepsPerSeed = 2500;
+
+} // namespace
+
+/**
+ * @brief Сравнить биржу с эталонной моделью на случайных командах.
+ * @details Начальные значения генератора фиксированы, поэтому проверка
+ * воспроизводима. Длительные прогоны выполняет differential_soak.
+ */
+int main() {
+  DifferentialHarness::silenceExchangeOutput();
+  for (std::uint64_t seed = 1; seed <= seeds; ++seed) {
+    DifferentialHarness harness;
+    Entropy entropy(seed);
+    while (harness.steps() < stepsPerSeed) {
+      if (!harness.step(entropy)) {
+        std::cerr << "FAILED with seed " << seed << std::endl;
+        return 1;
+      }
+    }
+  }
+  std::cerr << "passed" << std::endl;
+  return 0;
+}
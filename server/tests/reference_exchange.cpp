@@ -0,0 +1,561 @@
+#include "reference_exchange.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+using Units = ReferenceExchange::Units;
+
+//! Количество единиц модели в единице цены, объёма или суммы.
+constexpr Units unitScale = 10000;
+//! Одна секунда (нс): сроки действия проверяются на границах секунд.
+constexpr std::int64_t second = 1000000000;
+//! Одни сутки (нс).
+constexpr std::int64_t day = 86400 * second;
+
+//! Ответ на запрос пользователя, который не зарегистрирован.
+const std::string unknownUserName = "Unknown User";
+
+/**
+ * @brief Перевести число в единицы модели.
+ * @param value Число.
+ * @param units Число в единицах модели.
+ * @return true-число кратно единице модели, false-нет.
+ */
+bool toUnits(float value, Units &units) {
+  const double scaled = static_cast<double>(value) * unitScale;
+  units = std::llround(scaled);
+  return std::fabs(scaled - static_cast<double>(units)) <=
+         1e-6 * std::fabs(scaled) + 1e-3;
+}
+
+/**
+ * @brief Перевести число из единиц модели.
+ * @param units Число в единицах модели.
+ * @return Число.
+ */
+double fromUnits(Units units) {
+  return static_cast<double>(units) / unitScale;
+}
+
+/**
+ * @brief Разделить с округлением половины от нуля.
+ * @param value Делимое.
+ * @param divisor Делитель (больше нуля).
+ * @return Частное.
+ */
+Units divideRounded(Units value, Units divisor) {
+  return value >= 0 ? (value + divisor / 2) / divisor
+                    : -((-value + divisor / 2) / divisor);
+}
+
+/**
+ * @brief Перемножить числа в единицах модели.
+ * @param lhs Первый множитель.
+ * @param rhs Второй множитель.
+ * @return Произведение в единицах модели.
+ */
+Units multiply(Units lhs, Units rhs) {
+  return divideRounded(lhs * rhs, unitScale);
+}
+
+/**
+ * @brief Получить цену, обратную заданной.
+ * @param price Цена в единицах модели.
+ * @return Обратная цена в единицах модели.
+ */
+Units invert(Units price) {
+  return divideRounded(unitScale * unitScale, price);
+}
+
+/**
+ * @brief Получить сторону заявки в "стакане" канонического инструмента.
+ * @param type Тип заявки.
+ * @param inverted Заявка подана по обратной паре.
+ * @return Тип заявки в "стакане".
+ */
+std::uint8_t bookSide(common::OrderType type, bool inverted) {
+  if (!inverted) {
+    return static_cast<std::uint8_t>(type);
+  }
+  return static_cast<std::uint8_t>(type == common::OrderType_Buy
+                                       ? common::OrderType_Sell
+                                       : common::OrderType_Buy);
+}
+
+/**
+ * @brief Получить худшую цену исполнения стоп-заявки по рынку.
+ * @param type Тип заявки.
+ * @param stopPrice Цена срабатывания в единицах модели.
+ * @param tick Шаг цены в единицах модели.
+ * @return Цена, отстоящая от цены срабатывания на limits::stopPriceBand в
+ * худшую для заявки сторону и округлённая до шага цены также в худшую
+ * сторону, но не ниже шага цены.
+ */
+Units stopLimitPrice(common::OrderType type, Units stopPrice, Units tick) {
+  const Units bandPercent = std::llround(limits::stopPriceBand * 100.);
+  if (type == common::OrderType_Buy) {
+    const Units limit = stopPrice * (100 + bandPercent);
+    return (limit + 100 * tick - 1) / (100 * tick) * tick;
+  }
+  const Units limit = stopPrice * (100 - bandPercent);
+  return std::max(tick, limit / (100 * tick) * tick);
+}
+
+} // namespace
+
+std::size_t ReferenceExchange::registerNewUser(const std::string &userName) {
+  for (std::size_t userId = 0; userId < users_.size(); ++userId) {
+    if (users_[userId].name == userName) {
+      return userId;
+    }
+  }
+  users_.emplace_back().name = userName;
+  return users_.size() - 1;
+}
+
+std::string ReferenceExchange::registerOrder(const common::Order &order) {
+  if (order.instrument >= common::currency::InstrumentCount) {
+    return "Unknown currency pair";
+  }
+  if ((order.type != common::OrderType_Buy) &&
+      (order.type != common::OrderType_Sell)) {
+    return "Invalid order";
+  }
+  const common::currency::Instrument &quoted =
+      common::currency::instruments[order.instrument];
+  Units tick = 0;
+  toUnits(quoted.tickSize, tick);
+  const bool stop = (order.kind == common::OrderKind_Stop) ||
+                    (order.kind == common::OrderKind_StopLimit);
+  Units stopPrice = 0;
+  if (stop && (!toUnits(order.stopPrice, stopPrice) || (stopPrice <= 0) ||
+               (stopPrice % tick != 0))) {
+    return "Invalid stop price";
+  }
+  Units price = 0;
+  bool priceOnTick = true;
+  if (order.kind == common::OrderKind_Stop) {
+    price = stopLimitPrice(order.type, stopPrice, tick);
+  } else {
+    priceOnTick = toUnits(order.price, price) && (price % tick == 0);
+  }
+  if (!priceOnTick) {
+    return "Price is not a multiple of tick size";
+  }
+  Units volume = 0;
+  toUnits(order.volume, volume);
+  if ((volume <= 0) || (price <= 0) ||
+      (order.kind > common::OrderKind_Iceberg)) {
+    return "Invalid order";
+  }
+  Units peak = 0;
+  toUnits(order.peak, peak);
+  if ((order.kind == common::OrderKind_Iceberg) &&
+      ((peak <= 0) || (peak > volume))) {
+    return "Invalid iceberg peak";
+  }
+  const bool immediate = (order.timeInForce == common::TimeInForce_IOC) ||
+                         (order.timeInForce == common::TimeInForce_FOK);
+  if ((order.timeInForce > common::TimeInForce_GTD) || (stop && immediate)) {
+    return "Invalid time in force";
+  }
+  if ((order.timeInForce == common::TimeInForce_GTD) &&
+      (order.expireTime <= order.timestamp)) {
+    return "Invalid expire time";
+  }
+  if (order.userID >= users_.size()) {
+    return unknownUserName;
+  }
+
+  // Заявка по обратной паре исполняется в "стакане" прямой пары: покупка
+  // объёма V по цене P - это продажа объёма V * P по цене 1 / P.
+  const bool inverted = quoted.canonical != quoted.id;
+  Order added;
+  added.user = order.userID;
+  added.instrument = quoted.canonical;
+  added.type = bookSide(order.type, inverted);
+  added.pendingStop = stop;
+  added.price = inverted ? invert(price) : price;
+  added.volume = inverted ? multiply(volume, price) : volume;
+  if (stop) {
+    added.stopPrice = inverted ? invert(stopPrice) : stopPrice;
+  }
+  if (order.kind == common::OrderKind_Iceberg) {
+    added.peak = inverted ? multiply(peak, price) : peak;
+  }
+
+  User &user = users_[order.userID];
+  const std::size_t openOrders = static_cast<std::size_t>(
+      std::count_if(orders_.begin(), orders_.end(),
+                    [&order](const Order &open) {
+                      return open.user == order.userID;
+                    }));
+  if (openOrders >= limits::maxOpenOrders) {
+    return "Open orders limit exceeded";
+  }
+  Units maxNotional = 0;
+  toUnits(limits::maxOpenNotional, maxNotional);
+  if (user.openNotional + multiply(added.price, added.volume) > maxNotional) {
+    return "Open notional limit exceeded";
+  }
+  // Покупка резервирует стоимость заявки, продажа - продаваемый объём.
+  const common::currency::Instrument &book =
+      common::currency::instruments[quoted.canonical];
+  const bool buy = added.type == common::OrderType_Buy;
+  const common::currency::CurrencyId currency = buy ? book.quote : book.base;
+  const Units required =
+      buy ? multiply(added.price, added.volume) : added.volume;
+  if (user.balance[currency] - user.reserved[currency] < required) {
+    return "Insufficient funds";
+  }
+  if (order.timeInForce == common::TimeInForce_FOK) {
+    // FOK проверяет встречные заявки, оставшиеся после совмещения
+    // пересечённого между тактами "стакана".
+    match(quoted.canonical, order.timestamp);
+    Units available = 0;
+    for (const Order &open : orders_) {
+      if ((open.instrument == added.instrument) &&
+          (open.type != added.type) && !open.pendingStop &&
+          (buy ? open.price <= added.price : open.price >= added.price)) {
+        available += open.volume;
+      }
+    }
+    if (available < added.volume) {
+      return "Order killed: insufficient liquidity";
+    }
+  }
+
+  added.id = ++lastOrderId_;
+  if (!stop) {
+    added.queued = ++lastQueued_;
+  }
+  if (order.kind == common::OrderKind_Iceberg) {
+    added.reserve = added.volume - std::min(added.peak, added.volume);
+    added.volume -= added.reserve;
+  }
+  if (order.timeInForce == common::TimeInForce_DAY) {
+    added.expireTime = (order.timestamp / day + 1) * day;
+  } else if (order.timeInForce == common::TimeInForce_GTD) {
+    added.expireTime = order.expireTime;
+  }
+  changeReserve(added, added.volume + added.reserve);
+  orders_.push_back(added);
+
+  if (immediate) {
+    match(quoted.canonical, order.timestamp);
+    if (find(added.id) != orders_.size()) {
+      erase(added.id);
+    }
+  }
+  return "Order registration accepted. Order id: " + std::to_string(added.id);
+}
+
+std::string ReferenceExchange::cancelOrder(const common::Order &order) {
+  if (order.userID >= users_.size()) {
+    return unknownUserName;
+  }
+  const std::size_t index = find(order.id);
+  if ((index == orders_.size()) || (orders_[index].user != order.userID)) {
+    return "Order not found";
+  }
+  erase(order.id);
+  return "Order cancel accepted. Order id: " + std::to_string(order.id);
+}
+
+std::string
+ReferenceExchange::deposit(std::size_t userId,
+                           common::currency::CurrencyId currency, float value) {
+  if (currency >= common::currency::CurrencyCount) {
+    return "Unknown currency type";
+  }
+  Units amount = 0;
+  toUnits(value, amount);
+  if (amount <= 0) {
+    return "Invalid value";
+  }
+  if (userId >= users_.size()) {
+    return unknownUserName;
+  }
+  users_[userId].balance[currency] += amount;
+  return "Deposit accepted";
+}
+
+std::string ReferenceExchange::withdraw(std::size_t userId,
+                                        common::currency::CurrencyId currency,
+                                        float value) {
+  if (currency >= common::currency::CurrencyCount) {
+    return "Unknown currency type";
+  }
+  Units amount = 0;
+  toUnits(value, amount);
+  if (amount <= 0) {
+    return "Invalid value";
+  }
+  if (userId >= users_.size()) {
+    return unknownUserName;
+  }
+  User &user = users_[userId];
+  if (user.balance[currency] - user.reserved[currency] < amount) {
+    return "Insufficient funds";
+  }
+  user.balance[currency] -= amount;
+  return "Withdraw accepted";
+}
+
+void ReferenceExchange::process(std::int64_t timestamp) {
+  // Заявка снимается на первой границе секунды, не предшествующей её сроку
+  // действия, начиная с такта, которому принадлежит эта граница.
+  const std::int64_t tickStart = timestamp / second * second;
+  std::vector<std::uint64_t> expired;
+  for (const Order &order : orders_) {
+    const std::int64_t boundary =
+        (order.expireTime + second - 1) / second * second;
+    if ((order.expireTime != 0) && (boundary <= tickStart)) {
+      expired.push_back(order.id);
+    }
+  }
+  for (const std::uint64_t id : expired) {
+    erase(id);
+  }
+  for (const common::currency::Instrument &instrument :
+       common::currency::instruments) {
+    if (instrument.canonical == instrument.id) {
+      match(instrument.id, timestamp);
+    }
+  }
+}
+
+nlohmann::json ReferenceExchange::dumpState() const {
+  const auto dumpAmounts = [](const auto &amounts) {
+    nlohmann::json values = nlohmann::json::array();
+    for (const Units amount : amounts) {
+      values.push_back(fromUnits(amount));
+    }
+    return values;
+  };
+  nlohmann::json state;
+  state["lastOrderId"] = lastOrderId_;
+  nlohmann::json &usersState = state["users"];
+  usersState = nlohmann::json::array();
+  for (std::size_t userId = 0; userId < users_.size(); ++userId) {
+    usersState.push_back({{"id", userId},
+                          {"name", users_[userId].name},
+                          {"balance", dumpAmounts(users_[userId].balance)},
+                          {"reserved", dumpAmounts(users_[userId].reserved)}});
+  }
+  nlohmann::json &booksState = state["books"];
+  booksState = nlohmann::json::array();
+  for (std::size_t instrument = 0;
+       instrument < common::currency::InstrumentCount; ++instrument) {
+    // Заявки стороны в порядке приоритета: активные - по цене, затем по
+    // очереди; стоп-заявки - по близости цены срабатывания к рынку, затем
+    // по номеру.
+    const auto dumpSide = [this, instrument](std::uint8_t type, bool stops) {
+      const bool buy = type == common::OrderType_Buy;
+      std::vector<const Order *> side;
+      for (const Order &order : orders_) {
+        if ((order.instrument == instrument) && (order.type == type) &&
+            (order.pendingStop == stops)) {
+          side.push_back(&order);
+        }
+      }
+      std::sort(side.begin(), side.end(),
+                [buy, stops](const Order *lhs, const Order *rhs) {
+                  if (stops) {
+                    if (lhs->stopPrice != rhs->stopPrice) {
+                      return (lhs->stopPrice < rhs->stopPrice) == buy;
+                    }
+                    return lhs->id < rhs->id;
+                  }
+                  if (lhs->price != rhs->price) {
+                    return (lhs->price > rhs->price) == buy;
+                  }
+                  return lhs->queued < rhs->queued;
+                });
+      nlohmann::json orders = nlohmann::json::array();
+      for (const Order *order : side) {
+        if (stops) {
+          orders.push_back({order->id, order->user,
+                            fromUnits(order->stopPrice),
+                            fromUnits(order->price),
+                            fromUnits(order->volume)});
+        } else {
+          orders.push_back({order->id, order->user, fromUnits(order->price),
+                            fromUnits(order->volume),
+                            fromUnits(order->reserve)});
+        }
+      }
+      return orders;
+    };
+    booksState.push_back(
+        {{"buy", dumpSide(common::OrderType_Buy, false)},
+         {"sell", dumpSide(common::OrderType_Sell, false)},
+         {"buyStops", dumpSide(common::OrderType_Buy, true)},
+         {"sellStops", dumpSide(common::OrderType_Sell, true)}});
+  }
+  return state;
+}
+
+std::vector<Trade> ReferenceExchange::takeTrades() {
+  std::vector<Trade> trades;
+  trades.swap(trades_);
+  return trades;
+}
+
+std::pair<std::size_t, std::uint64_t>
+ReferenceExchange::findOrder(std::size_t position) const {
+  if (orders_.empty()) {
+    return {common::unknownUser, 0};
+  }
+  const Order &order = orders_[position % orders_.size()];
+  return {order.user, order.id};
+}
+
+void ReferenceExchange::match(common::currency::InstrumentId instrument,
+                              std::int64_t timestamp) {
+  const common::currency::Instrument &book =
+      common::currency::instruments[instrument];
+  // Сумма сделки округляется до точности инструмента.
+  Units precisionStep = unitScale;
+  for (int i = 0; i < book.precision; ++i) {
+    precisionStep /= 10;
+  }
+  // Стоп-заявки, поданные после последней сделки, сравниваются с её ценой.
+  triggerStops(instrument, lastPrices_[instrument]);
+  for (;;) {
+    const std::size_t buyIndex = findBest(instrument, common::OrderType_Buy);
+    const std::size_t sellIndex =
+        findBest(instrument, common::OrderType_Sell);
+    if ((buyIndex == orders_.size()) || (sellIndex == orders_.size()) ||
+        (orders_[buyIndex].price < orders_[sellIndex].price)) {
+      break;
+    }
+    const Order buy = orders_[buyIndex];
+    const Order sell = orders_[sellIndex];
+    // Сделка заключается по цене заявки на покупку, инициатор - более
+    // поздняя заявка.
+    const Units volume = std::min(buy.volume, sell.volume);
+    const Units amount =
+        divideRounded(multiply(buy.price, volume), precisionStep) *
+        precisionStep;
+    trades_.push_back(Trade{timestamp, instrument,
+                            static_cast<float>(fromUnits(buy.price)),
+                            static_cast<float>(fromUnits(volume)),
+                            buy.id > sell.id ? common::OrderType_Buy
+                                             : common::OrderType_Sell});
+    lastPrices_[instrument] = buy.price;
+    fill(buy.id, volume);
+    fill(sell.id, volume);
+    users_[buy.user].balance[book.base] += volume;
+    users_[buy.user].balance[book.quote] -= amount;
+    users_[sell.user].balance[book.base] -= volume;
+    users_[sell.user].balance[book.quote] += amount;
+    triggerStops(instrument, buy.price);
+  }
+}
+
+std::size_t
+ReferenceExchange::findBest(common::currency::InstrumentId instrument,
+                            std::uint8_t type) const {
+  const bool buy = type == common::OrderType_Buy;
+  std::size_t best = orders_.size();
+  for (std::size_t index = 0; index < orders_.size(); ++index) {
+    const Order &order = orders_[index];
+    if ((order.instrument != instrument) || (order.type != type) ||
+        order.pendingStop) {
+      continue;
+    }
+    if (best == orders_.size()) {
+      best = index;
+      continue;
+    }
+    const Order &current = orders_[best];
+    if ((order.price != current.price)
+            ? ((order.price > current.price) == buy)
+            : (order.queued < current.queued)) {
+      best = index;
+    }
+  }
+  return best;
+}
+
+void ReferenceExchange::triggerStops(common::currency::InstrumentId instrument,
+                                     Units tradePrice) {
+  if (tradePrice <= 0) {
+    return;
+  }
+  // Заявка на покупку срабатывает, когда сделка прошла по цене срабатывания
+  // или выше, на продажу - по цене срабатывания или ниже. Сработавшие
+  // заявки встают в очереди уровней по близости цены срабатывания к рынку,
+  // при равной цене - в порядке регистрации.
+  std::vector<Order *> triggered;
+  for (Order &order : orders_) {
+    if ((order.instrument == instrument) && order.pendingStop &&
+        ((order.type == common::OrderType_Buy)
+             ? order.stopPrice <= tradePrice
+             : order.stopPrice >= tradePrice)) {
+      triggered.push_back(&order);
+    }
+  }
+  std::sort(triggered.begin(), triggered.end(),
+            [](const Order *lhs, const Order *rhs) {
+              if (lhs->type != rhs->type) {
+                return lhs->type == common::OrderType_Buy;
+              }
+              if (lhs->stopPrice != rhs->stopPrice) {
+                return (lhs->stopPrice < rhs->stopPrice) ==
+                       (lhs->type == common::OrderType_Buy);
+              }
+              return lhs->id < rhs->id;
+            });
+  for (Order *order : triggered) {
+    order->pendingStop = false;
+    order->queued = ++lastQueued_;
+  }
+}
+
+void ReferenceExchange::fill(std::uint64_t id, Units volume) {
+  Order &order = orders_[find(id)];
+  changeReserve(order, -volume);
+  order.volume -= volume;
+  if ((order.volume == 0) && (order.reserve > 0)) {
+    // "Айсберг" открывает следующую часть и встаёт в конец очереди уровня.
+    order.volume = std::min(order.peak, order.reserve);
+    order.reserve -= order.volume;
+    order.queued = ++lastQueued_;
+  }
+  if (order.volume == 0) {
+    erase(id);
+  }
+}
+
+void ReferenceExchange::erase(std::uint64_t id) {
+  const std::size_t index = find(id);
+  changeReserve(orders_[index],
+                -(orders_[index].volume + orders_[index].reserve));
+  orders_.erase(orders_.begin() + static_cast<std::ptrdiff_t>(index));
+}
+
+std::size_t ReferenceExchange::find(std::uint64_t id) const {
+  for (std::size_t index = 0; index < orders_.size(); ++index) {
+    if (orders_[index].id == id) {
+      return index;
+    }
+  }
+  return orders_.size();
+}
+
+void ReferenceExchange::changeReserve(const Order &order, Units volume) {
+  const common::currency::Instrument &book =
+      common::currency::instruments[order.instrument];
+  User &user = users_[order.user];
+  const Units notional = multiply(order.price, volume);
+  if (order.type == common::OrderType_Buy) {
+    user.reserved[book.quote] += notional;
+  } else {
+    user.reserved[book.base] += volume;
+  }
+  user.openNotional += notional;
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "common.h"
+#include "trade_store.h"
+
+/**
+ * @brief Эталонная модель биржи для дифференциальной проверки.
+ * @details Правила биржи реализованы заново простейшими средствами, без
+ * кода TradingExchangeClient: заявки хранятся одним списком в порядке
+ * регистрации, лучшая заявка каждой стороны ищется полным просмотром,
+ * приоритет внутри уровня цены задаётся номером постановки в очередь,
+ * стоп-заявки проверяются после каждой сделки. Цены, объёмы и суммы
+ * хранятся целыми числами десятитысячных долей, поэтому арифметика модели
+ * точна, а биржа сравнивается с ней с допуском на погрешность float. Модель
+ * рассчитана на входы DifferentialHarness: числа кратны десятитысячной
+ * доле, цены обратной пары имеют конечные обратные.
+ */
+class ReferenceExchange {
+public:
+  //! Число в десятитысячных долях.
+  using Units = std::int64_t;
+
+  /**
+   * @brief Зарегистрировать нового пользователя.
+   * @param userName Имя пользователя.
+   * @return ID нового (или уже зарегистрированного) пользователя.
+   */
+  std::size_t registerNewUser(const std::string &userName);
+
+  /**
+   * @brief Зарегистрировать заявку на покупку/продажу.
+   * @param order Заявка.
+   * @return Результат регистрации заявки.
+   */
+  std::string registerOrder(const common::Order &order);
+
+  /**
+   * @brief Отменить заявку.
+   * @param order Заявка (достаточно ID пользователя и номера заявки).
+   * @return Результат отмены заявки.
+   */
+  std::string cancelOrder(const common::Order &order);
+
+  /**
+   * @brief Внести денежные средства.
+   * @param userId ID пользователя.
+   * @param currency Валюта.
+   * @param value Сумма.
+   * @return Результат внесения денежных средств.
+   */
+  std::string deposit(std::size_t userId, common::currency::CurrencyId currency,
+                      float value);
+
+  /**
+   * @brief Снять денежные средства.
+   * @param userId ID пользователя.
+   * @param currency Валюта.
+   * @param value Сумма.
+   * @return Результат снятия денежных средств.
+   */
+  std::string withdraw(std::size_t userId,
+                       common::currency::CurrencyId currency, float value);
+
+  /**
+   * @brief Снять заявки с истёкшим сроком действия и совместить "стаканы".
+   * @param timestamp Текущее время (нс с начала эпохи).
+   */
+  void process(std::int64_t timestamp);
+
+  /**
+   * @brief Получить состояние в формате TradingExchangeClient::dumpState().
+   * @return Состояние в JSON.
+   */
+  nlohmann::json dumpState() const;
+
+  /**
+   * @brief Забрать сделки, совершённые после предыдущего вызова.
+   * @return Сделки в порядке совершения.
+   */
+  std::vector<Trade> takeTrades();
+
+  /**
+   * @brief Количество пользователей.
+   */
+  std::size_t userCount() const { return users_.size(); }
+
+  /**
+   * @brief Номер последней зарегистрированной заявки.
+   */
+  std::uint64_t lastOrderId() const { return lastOrderId_; }
+
+  /**
+   * @brief Найти владельца активной заявки.
+   * @param position Порядковый номер среди активных заявок (по модулю их
+   * количества).
+   * @return ID пользователя и номер заявки или {common::unknownUser, 0},
+   * если активных заявок нет.
+   */
+  std::pair<std::size_t, std::uint64_t>
+  findOrder(std::size_t position) const;
+
+private:
+  /**
+   * @brief Пользователь.
+   */
+  struct User {
+    std::string name; //!< Имя.
+    //! Баланс по валютам.
+    std::array<Units, common::currency::CurrencyCount> balance = {};
+    //! Резерв под активные заявки по валютам.
+    std::array<Units, common::currency::CurrencyCount> reserved = {};
+    Units openNotional = 0; //!< Суммарная стоимость активных заявок.
+  };
+
+  /**
+   * @brief Активная заявка в "стакане" канонического инструмента.
+   */
+  struct Order {
+    std::uint64_t id = 0; //!< Номер заявки.
+    std::size_t user = 0; //!< ID пользователя.
+    //! Инструмент "стакана".
+    common::currency::InstrumentId instrument =
+        common::currency::InstrumentCount;
+    std::uint8_t type = 0;    //!< Тип заявки.
+    bool pendingStop = false; //!< Стоп-заявка ещё не сработала.
+    Units price = 0;          //!< Цена.
+    Units volume = 0;         //!< Видимый объём.
+    Units reserve = 0;        //!< Скрытый объём "айсберга".
+    Units peak = 0;           //!< Видимая часть "айсберга".
+    Units stopPrice = 0;      //!< Цена срабатывания стоп-заявки.
+    //! Срок действия (нс с начала эпохи, 0 - бессрочная).
+    std::int64_t expireTime = 0;
+    //! Номер постановки в очередь уровня цены (приоритет внутри уровня).
+    std::uint64_t queued = 0;
+  };
+
+  /**
+   * @brief Совместить заявки в "стакане" инструмента.
+   * @param instrument Канонический инструмент.
+   * @param timestamp Время сделок.
+   */
+  void match(common::currency::InstrumentId instrument,
+             std::int64_t timestamp);
+
+  /**
+   * @brief Найти лучшую заявку стороны "стакана".
+   * @param instrument Инструмент "стакана".
+   * @param type Сторона.
+   * @return Индекс заявки в orders_ или orders_.size(), если заявок нет.
+   */
+  std::size_t findBest(common::currency::InstrumentId instrument,
+                       std::uint8_t type) const;
+
+  /**
+   * @brief Перенести в "стакан" стоп-заявки, достигнутые ценой сделки.
+   * @param instrument Инструмент "стакана".
+   * @param tradePrice Цена сделки (0 - сделок не было).
+   */
+  void triggerStops(common::currency::InstrumentId instrument,
+                    Units tradePrice);
+
+  /**
+   * @brief Исполнить часть заявки.
+   * @param id Номер заявки.
+   * @param volume Исполненный объём.
+   */
+  void fill(std::uint64_t id, Units volume);
+
+  /**
+   * @brief Удалить заявку и освободить её резерв.
+   * @param id Номер заявки.
+   */
+  void erase(std::uint64_t id);
+
+  /**
+   * @brief Найти заявку по номеру.
+   * @param id Номер заявки.
+   * @return Индекс заявки в orders_ или orders_.size().
+   */
+  std::size_t find(std::uint64_t id) const;
+
+  /**
+   * @brief Изменить резерв под часть заявки.
+   * @param order Заявка.
+   * @param volume Объём (отрицательный - освободить резерв).
+   */
+  void changeReserve(const Order &order, Units volume);
+
+  std::vector<User> users_;   //!< Пользователи, индекс - ID.
+  std::vector<Order> orders_; //!< Активные заявки в порядке регистрации.
+  std::vector<Trade> trades_; //!< Сделки после последнего takeTrades().
+  std::uint64_t lastOrderId_ = 0; //!< Номер последней заявки.
+  std::uint64_t lastQueued_ = 0;  //!< Последний номер постановки в очередь.
+  //! Цена последней сделки по инструментам.
+  std::array<Units, common::currency::InstrumentCount> lastPrices_ = {};
+};
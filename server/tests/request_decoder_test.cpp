@@ -0,0 +1,575 @@
+#include "request_decoder.h"
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+//! Начальное значение генератора: прогон воспроизводим.
+constexpr std::uint64_t seed = 20261019;
+//! Количество случайных запросов.
+constexpr std::size_t iterations = 20000;
+
+/**
+ * @brief Запрос, разобранный библиотекой JSON.
+ */
+struct Expected {
+  std::string type;    //!< Тип запроса (ReqType).
+  std::string message; //!< Сообщение запроса (Message).
+  common::Order order; //!< Заявка (запросы Buy, Sell, Cancel).
+  //! Валюта (запросы Deposit, Withdraw).
+  common::currency::CurrencyId currency = common::currency::CurrencyCount;
+  float amount = 0.f; //!< Сумма (запросы Deposit, Withdraw).
+};
+
+/**
+ * @brief Разобрать запрос библиотекой JSON так же, как
+ * RequestHandler::parseRequest.
+ * @param request Запрос.
+ * @param expected Результат разбора.
+ * @return true-запрос разобран, false-библиотека отвергла запрос.
+ */
+bool parseWithLibrary(const std::string &request, Expected &expected) {
+  try {
+    const nlohmann::json json = nlohmann::json::parse(request);
+    expected.type = json.at("ReqType").get<std::string>();
+    expected.message = json.at("Message").get<std::string>();
+    if ((expected.type == common::requests::Buy) ||
+        (expected.type == common::requests::Sell) ||
+        (expected.type == common::requests::Cancel)) {
+      nlohmann::json j = nlohmann::json::parse(expected.message);
+      common::Order &order = expected.order;
+      order.instrument = common::currency::findInstrument(
+          common::currency::findCurrency(
+              j["volume"]["currencyType"].get<std::string>()),
+          common::currency::findCurrency(
+              j["price"]["currencyType"].get<std::string>()));
+      order.volume = j["volume"]["value"].get<float>();
+      order.price = j["price"]["value"].get<float>();
+      order.type = j["type"].get<common::OrderType>();
+      order.kind = j.value("kind", common::OrderKind_Limit);
+      order.stopPrice = j.value("stopPrice", 0.f);
+      order.peak = j.value("peak", 0.f);
+      order.timeInForce = j.value("timeInForce", common::TimeInForce_GTC);
+      order.expireTime = j.value("expireTime", std::int64_t(0));
+      if (j.contains("id")) {
+        order.id = j["id"].get<std::uint64_t>();
+      }
+    } else if ((expected.type == common::requests::Deposit) ||
+               (expected.type == common::requests::Withdraw)) {
+      nlohmann::json j = nlohmann::json::parse(expected.message);
+      const common::CurrencyTypeValue pair(
+          j["pair"].get<common::CurrencyTypeValue>());
+      expected.currency = common::currency::findCurrency(pair.first);
+      expected.amount = pair.second;
+    }
+    return true;
+  } catch (const nlohmann::json::exception &) {
+    return false;
+  }
+}
+
+/**
+ * @brief Сравнить числа побитово (в том числе знак нуля).
+ */
+bool sameBits(float left, float right) {
+  return std::bit_cast<std::uint32_t>(left) ==
+         std::bit_cast<std::uint32_t>(right);
+}
+
+/**
+ * @brief Сравнить команду декодера с разбором библиотеки.
+ * @param command Команда декодера.
+ * @param expected Разбор библиотеки.
+ * @return true-совпадают, false-нет.
+ */
+bool sameCommand(const Command &command, const Expected &expected) {
+  const common::Order &left = command.order;
+  const common::Order &right = expected.order;
+  return (command.type == expected.type) &&
+         (command.message == expected.message) &&
+         (left.instrument == right.instrument) &&
+         sameBits(left.volume, right.volume) &&
+         sameBits(left.price, right.price) && (left.type == right.type) &&
+         (left.kind == right.kind) &&
+         sameBits(left.stopPrice, right.stopPrice) &&
+         sameBits(left.peak, right.peak) &&
+         (left.timeInForce == right.timeInForce) &&
+         (left.expireTime == right.expireTime) && (left.id == right.id) &&
+         (command.currency == expected.currency) &&
+         sameBits(command.amount, expected.amount);
+}
+
+/**
+ * @brief Счётчики проверенных запросов.
+ */
+struct Statistics {
+  std::size_t decoded = 0;   //!< Декодированы без библиотеки.
+  std::size_t escaped = 0;   //!< Из них с экранированием в строках.
+  std::size_t fallback = 0;  //!< Переданы библиотеке и приняты ею.
+  std::size_t rejected = 0;  //!< Отвергнуты обоими.
+  std::size_t truncated = 0; //!< Обрезанные запросы.
+};
+
+/**
+ * @brief Проверить запрос.
+ * @param request Запрос.
+ * @param statistics Счётчики.
+ * @return true-декодер согласован с библиотекой, false-нет.
+ * @details Если декодер принял запрос, библиотека должна принять его же и
+ * дать ту же команду. Если декодер вернул false, запрос разбирается
+ * библиотекой, и сравнивать нечего.
+ */
+bool check(const std::string &request, Statistics &statistics) {
+  std::string buffer = request;
+  Command command;
+  const bool decoded = decodeRequest(buffer.data(), buffer.size(), command);
+  Expected expected;
+  const bool parsed = parseWithLibrary(request, expected);
+  if (!decoded) {
+    ++(parsed ? statistics.fallback : statistics.rejected);
+    return true;
+  }
+  ++statistics.decoded;
+  if (request.find('\\') != std::string::npos) {
+    ++statistics.escaped;
+  }
+  if (!parsed) {
+    std::cout << "decoded a request the library rejects: " << request
+              << std::endl;
+    return false;
+  }
+  if (!sameCommand(command, expected)) {
+    std::cout << "decoded differently from the library: " << request
+              << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Генератор запросов протокола.
+ * @details Строит корректные запросы всех видов с переставленными и
+ * лишними полями, пробелами, числами разной записи и экранированием в
+ * строках, а также портит их.
+ */
+class RequestGenerator {
+public:
+  /**
+   * @brief Конструктор.
+   * @param seed Начальное значение генератора.
+   */
+  explicit RequestGenerator(std::uint64_t seed) : random_(seed) {}
+
+  /**
+   * @brief Сгенерировать корректный запрос.
+   * @return Запрос в JSON.
+   */
+  std::string request() {
+    static const std::string types[] = {
+        common::requests::Buy,      common::requests::Sell,
+        common::requests::Cancel,   common::requests::Deposit,
+        common::requests::Withdraw, common::requests::SignIn,
+        common::requests::SignUp,   common::requests::Balance,
+        common::requests::Orders,   "Unknown"};
+    const std::string &type = types[pick(std::size(types))];
+    std::string message;
+    if ((type == common::requests::Buy) || (type == common::requests::Sell) ||
+        (type == common::requests::Cancel)) {
+      message = order();
+    } else if ((type == common::requests::Deposit) ||
+               (type == common::requests::Withdraw)) {
+      message = pair();
+    } else {
+      message = text();
+    }
+    std::vector<std::string> members = {member("ReqType", quote(type)),
+                                        member("Message", quote(message))};
+    if (pick(4) == 0) {
+      members.push_back(member("UserId", integer()));
+    }
+    return object(members) + space();
+  }
+
+  /**
+   * @brief Испортить запрос.
+   * @param request Запрос.
+   * @return Запрос с одной-тремя случайными правками.
+   */
+  std::string mutate(std::string request) {
+    static const std::string bytes = " {}[]\":,\\-+.0123456789eEtrufalsn/u";
+    const std::size_t count = 1 + pick(3);
+    for (std::size_t i = 0; (i < count) && !request.empty(); ++i) {
+      const std::size_t position = pick(request.size());
+      switch (pick(4)) {
+      case 0:
+        request.erase(position, 1);
+        break;
+      case 1:
+        request.insert(position, 1, bytes[pick(bytes.size())]);
+        break;
+      case 2:
+        request[position] = bytes[pick(bytes.size())];
+        break;
+      default:
+        request.insert(position, request.substr(pick(request.size()),
+                                                1 + pick(8)));
+        break;
+      }
+    }
+    return request;
+  }
+
+  /**
+   * @brief Обрезать запрос.
+   * @param request Запрос.
+   * @return Запрос без части конца, в которой есть не только пробелы.
+   */
+  std::string truncate(const std::string &request) {
+    const std::size_t end = request.find_last_not_of(" \t\r\n");
+    return request.substr(0, pick(end + 1));
+  }
+
+private:
+  /**
+   * @brief Случайное число от 0 до bound - 1.
+   */
+  std::size_t pick(std::size_t bound) {
+    return std::uniform_int_distribution<std::size_t>(0, bound - 1)(random_);
+  }
+
+  /**
+   * @brief Пробелы между лексемами (чаще всего пустые).
+   */
+  std::string space() {
+    static const char spaces[] = {' ', '\t', '\r', '\n'};
+    std::string result;
+    if (pick(4) == 0) {
+      result.assign(1 + pick(2), spaces[pick(std::size(spaces))]);
+    }
+    return result;
+  }
+
+  /**
+   * @brief Целое число, в том числе отрицательное и больше 32 бит.
+   */
+  std::string integer() {
+    static const std::string special[] = {"0", "-0", "18446744073709551615",
+                                          "-9223372036854775808",
+                                          "18446744073709551616"};
+    if (pick(8) == 0) {
+      return special[pick(std::size(special))];
+    }
+    const std::uint64_t value = random_() >> pick(64);
+    return (pick(8) == 0 ? "-" : "") + std::to_string(value);
+  }
+
+  /**
+   * @brief Небольшое целое число (тип, вид заявки, срок действия).
+   * @param bound Количество значений.
+   */
+  std::string enumeration(std::size_t bound) {
+    if (pick(16) == 0) {
+      return pick(2) == 0 ? "1.0" : "1e0";
+    }
+    return std::to_string(pick(bound));
+  }
+
+  /**
+   * @brief Число с плавающей точкой в одной из записей JSON.
+   */
+  std::string real() {
+    static const std::string special[] = {
+        "-0.0", "1e-50", "3.5e38", "1e400", "0.1", "1E+2", "2.5e-3", "100"};
+    switch (pick(4)) {
+    case 0:
+      return special[pick(std::size(special))];
+    case 1:
+      return std::to_string(pick(100000));
+    default:
+      return std::to_string(pick(100000)) + "." +
+             std::to_string(pick(10000));
+    }
+  }
+
+  /**
+   * @brief Название валюты (изредка - неизвестной).
+   */
+  std::string currency() {
+    static const std::string names[] = {"USD", "RU", "EUR", ""};
+    return names[pick(5) < 4 ? pick(2) : 2 + pick(2)];
+  }
+
+  /**
+   * @brief Строка с символами, которые требуют экранирования.
+   */
+  std::string text() {
+    static const std::string pieces[] = {
+        "a", "Z", "7", " ", "\"", "\\", "/", "\n", "\t", "\b",
+        "\f", "\r", "\x01", "\x1f", "\xc3\xa9", "{", "}", ":"};
+    std::string result;
+    const std::size_t length = pick(12);
+    for (std::size_t i = 0; i < length; ++i) {
+      result += pieces[pick(std::size(pieces))];
+    }
+    return result;
+  }
+
+  /**
+   * @brief Записать строку литералом JSON.
+   * @param value Строка.
+   * @return Литерал с кавычками; экранирование выбирается случайно из
+   * допустимых вариантов.
+   */
+  std::string quote(const std::string &value) {
+    static const char hex[] = "0123456789abcdef";
+    std::string result = "\"";
+    for (const char c : value) {
+      const auto byte = static_cast<unsigned char>(c);
+      const auto unicode = [&result, byte]() {
+        result += "\\u00";
+        result += hex[byte >> 4];
+        result += hex[byte & 0xf];
+      };
+      const char *shortEscape = nullptr;
+      switch (c) {
+      case '"':
+        shortEscape = "\\\"";
+        break;
+      case '\\':
+        shortEscape = "\\\\";
+        break;
+      case '\b':
+        shortEscape = "\\b";
+        break;
+      case '\f':
+        shortEscape = "\\f";
+        break;
+      case '\n':
+        shortEscape = "\\n";
+        break;
+      case '\r':
+        shortEscape = "\\r";
+        break;
+      case '\t':
+        shortEscape = "\\t";
+        break;
+      default:
+        break;
+      }
+      if (shortEscape != nullptr) {
+        if (pick(16) == 0) {
+          unicode();
+        } else {
+          result += shortEscape;
+        }
+      } else if (byte < 0x20) {
+        unicode();
+      } else if ((c == '/') && (pick(2) == 0)) {
+        result += "\\/";
+      } else if ((byte < 0x80) && (pick(64) == 0)) {
+        unicode();
+      } else {
+        result += c;
+      }
+    }
+    return result + "\"";
+  }
+
+  /**
+   * @brief Поле объекта.
+   * @param key Ключ.
+   * @param value Значение в JSON.
+   */
+  std::string member(const std::string &key, const std::string &value) {
+    return quote(key) + space() + ":" + space() + value;
+  }
+
+  /**
+   * @brief Значение неизвестного поля.
+   */
+  std::string unknownValue() {
+    static const std::string values[] = {
+        "null", "true", "false", "\"x\"", "[]", "{}", "-2.5e1",
+        "[1,[true,{\"a\":null}],\"b\\\"\"]", "{\"volume\":{\"value\":1}}"};
+    return values[pick(std::size(values))];
+  }
+
+  /**
+   * @brief Объект из полей в случайном порядке, изредка с лишним полем.
+   * @param members Поля.
+   */
+  std::string object(std::vector<std::string> members) {
+    if (pick(4) == 0) {
+      members.push_back(member("extra", unknownValue()));
+    }
+    std::shuffle(members.begin(), members.end(), random_);
+    std::string result = space() + "{" + space();
+    for (std::size_t i = 0; i < members.size(); ++i) {
+      if (i != 0) {
+        result += space() + "," + space();
+      }
+      result += members[i];
+    }
+    return result + space() + "}";
+  }
+
+  /**
+   * @brief Сумма: {"currencyType":..,"value":..}.
+   */
+  std::string amount() {
+    std::vector<std::string> members;
+    if (pick(32) != 0) {
+      members.push_back(member("currencyType", quote(currency())));
+    }
+    if (pick(32) != 0) {
+      members.push_back(member("value", real()));
+    }
+    return object(members);
+  }
+
+  /**
+   * @brief Заявка с обязательными и случайным набором необязательных
+   * полей.
+   */
+  std::string order() {
+    std::vector<std::string> members = {member("volume", amount()),
+                                        member("price", amount()),
+                                        member("type", enumeration(3))};
+    const auto optional = [this, &members](const std::string &key,
+                                           const std::string &value) {
+      if (pick(2) == 0) {
+        members.push_back(member(key, value));
+      }
+    };
+    optional("kind", enumeration(4));
+    optional("stopPrice", real());
+    optional("peak", real());
+    optional("timeInForce", enumeration(5));
+    optional("expireTime", integer());
+    optional("id", integer());
+    if (pick(32) == 0) {
+      members.erase(members.begin() + pick(3));
+    }
+    return object(members);
+  }
+
+  /**
+   * @brief Пара валюта-сумма: {"pair":[валюта,сумма]}.
+   */
+  std::string pair() {
+    std::string value = "[" + space() + quote(currency()) + space() + "," +
+                        space() + real();
+    if (pick(32) == 0) {
+      value += ",1";
+    }
+    return object({member("pair", value + space() + "]")});
+  }
+
+  std::mt19937_64 random_; //!< Генератор.
+};
+
+/**
+ * @brief Проверить запросы с заранее известным путём разбора.
+ * @param statistics Счётчики.
+ * @return true-декодер выбрал ожидаемый путь и согласован с библиотекой,
+ * false-нет.
+ */
+bool checkKnownRequests(Statistics &statistics) {
+  struct Case {
+    std::string request; //!< Запрос.
+    bool decoded;        //!< Ожидаемый результат decodeRequest.
+  };
+  const Case cases[] = {
+      {R"({"ReqType":"Buy","Message":"{\"volume\":{\"currencyType\":\"USD\",)"
+       R"(\"value\":1},\"price\":{\"currencyType\":\"RU\",\"value\":62.5},)"
+       R"(\"type\":1}"})",
+       true},
+      {R"({"Message":"{\"pair\":[\"RU\",1e3]}","ReqType":"Deposit"})", true},
+      {R"( { "ReqType" : "SignUp" , "Message" : "a\"b\\c\/d\n\t" } )", true},
+      {R"({"ReqType":"Balance","Message":"","x":[1,{"y":null}]})", true},
+      // Пути через библиотеку JSON.
+      {R"({"ReqType":"SignUp","Message":"\u0041"})", false},
+      {R"({"ReqType":"Deposit","Message":"{\"pair\":[\"R\\/U\",1]}"})",
+       false},
+      {"{\"ReqType\":\"SignUp\",\"Message\":\"\xc3\xa9\"}", false},
+      {R"({"ReqType":"Cancel","Message":"{\"volume\":{\"currencyType\":)"
+       R"(\"USD\",\"value\":1},\"price\":{\"currencyType\":\"RU\",)"
+       R"(\"value\":1},\"type\":1.0}"})",
+       false},
+      {R"({"ReqType":"Withdraw","Message":"{\"pair\":[\"RU\",1,2]}"})", false},
+      {R"({"ReqType":"Deposit","Message":"{\"pair\":[\"RU\",01]}"})", false},
+      {R"({"ReqType":"Deposit","Message":"{\"pair\":[\"RU\",1e400]}"})",
+       false},
+      // Некорректные запросы.
+      {R"({"ReqType":"Sell","Message":"{\"type\":2}"})", false},
+      {R"({"ReqType":"Deposit","Message":"{\"pair\":[\"RU\",1]} x"})", false},
+      {R"({"ReqType":"Balance","Message":""} x)", false},
+      {R"({"ReqType":"Balance","Message":"")", false},
+      {R"({"ReqType":"Balance","Message":"\)", false},
+      {R"({"ReqType":"Balance","Message":"\q"})", false},
+      {R"({"ReqType":"Balance"})", false},
+      {"", false},
+  };
+  bool passed = true;
+  for (const Case &known : cases) {
+    std::string buffer = known.request;
+    Command command;
+    if (decodeRequest(buffer.data(), buffer.size(), command) !=
+        known.decoded) {
+      std::cout << "unexpected decoder path: " << known.request << std::endl;
+      passed = false;
+    }
+    passed = check(known.request, statistics) && passed;
+  }
+  return passed;
+}
+
+/**
+ * @brief Проверить случайные корректные, испорченные и обрезанные запросы.
+ * @param statistics Счётчики.
+ * @return true-декодер согласован с библиотекой, false-нет.
+ * @details Обрезанный запрос не может быть корректным, поэтому декодер
+ * обязан передать его библиотеке.
+ */
+bool checkRandomRequests(Statistics &statistics) {
+  RequestGenerator generator(seed);
+  bool passed = true;
+  for (std::size_t i = 0; (i < iterations) && passed; ++i) {
+    const std::string request = generator.request();
+    const std::string truncated = generator.truncate(request);
+    std::string buffer = truncated;
+    Command command;
+    if (decodeRequest(buffer.data(), buffer.size(), command)) {
+      std::cout << "decoded a truncated request: " << truncated << std::endl;
+      passed = false;
+    }
+    ++statistics.truncated;
+    passed = check(request, statistics) && check(truncated, statistics) &&
+             check(generator.mutate(request), statistics) && passed;
+  }
+  return passed;
+}
+
+} // namespace
+
+int main() {
+  Statistics statistics;
+  bool passed = checkKnownRequests(statistics);
+  passed = checkRandomRequests(statistics) && passed;
+  std::cout << "decoded " << statistics.decoded << " (escaped "
+            << statistics.escaped << "), fallback " << statistics.fallback
+            << ", rejected " << statistics.rejected << ", truncated "
+            << statistics.truncated << std::endl;
+  // Каждый путь разбора должен быть пройден.
+  if ((statistics.decoded == 0) || (statistics.escaped == 0) ||
+      (statistics.fallback == 0) || (statistics.rejected == 0)) {
+    std::cout << "not every decoding path was exercised" << std::endl;
+    passed = false;
+  }
+  std::cout << (passed ? "passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
@@ -0,0 +1,68 @@
+#include "session_pool.h"
+
+#include <iostream>
+#include <thread>
+
+namespace {
+
+//! Количество заранее выделенных блоков.
+constexpr std::size_t reservedCount = 4;
+
+/**
+ * @brief Блок сессии.
+ */
+struct Block {
+  char data[200]; //!< Данные.
+};
+
+/**
+ * @brief Проверить возврат блоков пулу-владельцу.
+ * @return true-блоки вернулись в пул, которым заполнены, false-нет.
+ * @details Блоки выделяются в одном потоке и освобождаются в другом, как
+ * сессии, которые закрываются в потоке биржи. Прежде блоки оседали в пуле
+ * освобождающего потока сверх его предела, а пул-владелец переходил на
+ * общую кучу.
+ */
+bool checkForeignRelease() {
+  SessionAllocator<Block> allocator;
+  SessionPools::reserve(reservedCount, false);
+  std::vector<Block *> blocks;
+  for (std::size_t i = 0; i < reservedCount; ++i) {
+    blocks.push_back(allocator.allocate(1));
+  }
+
+  bool passed = true;
+  std::thread([&allocator, &blocks, &passed]() {
+    for (Block *block : blocks) {
+      allocator.deallocate(block, 1);
+    }
+    Block *block = allocator.allocate(1);
+    if (SessionPools::findOwner(block) != nullptr) {
+      std::cout << "reserved block stayed in the releasing thread"
+                << std::endl;
+      passed = false;
+    }
+    allocator.deallocate(block, 1);
+  }).join();
+
+  for (std::size_t i = 0; i < reservedCount; ++i) {
+    Block *block = allocator.allocate(1);
+    if (SessionPools::findOwner(block) == nullptr) {
+      std::cout << "owner thread fell back to the heap" << std::endl;
+      passed = false;
+    }
+    blocks[i] = block;
+  }
+  for (Block *block : blocks) {
+    allocator.deallocate(block, 1);
+  }
+  return passed;
+}
+
+} // namespace
+
+int main() {
+  const bool passed = checkForeignRelease();
+  std::cout << (passed ? "passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
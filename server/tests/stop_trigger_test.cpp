@@ -0,0 +1,104 @@
+#include "trading_exchange_client.h"
+
+#include <iostream>
+
+namespace {
+
+//! Время проверки (нс с начала эпохи).
+constexpr std::int64_t timestamp = 1792368000ll * 1000000000ll;
+
+/**
+ * @brief Зарегистрировать заявку на инструменте USD-RU.
+ * @param exchange Биржа.
+ * @param userId ID пользователя.
+ * @param type Тип заявки.
+ * @param volume Объём.
+ * @param price Цена.
+ * @param stopPrice Цена срабатывания (0 - лимитная заявка).
+ * @return true-заявка принята, false-нет.
+ */
+bool placeOrder(TradingExchangeClient &exchange, std::size_t userId,
+                common::OrderType type, float volume, float price,
+                float stopPrice = 0.f) {
+  common::Order order;
+  order.userID = userId;
+  order.instrument = common::currency::Instrument_USD_RU;
+  order.type = type;
+  order.kind = stopPrice > 0.f ? common::OrderKind_StopLimit
+                               : common::OrderKind_Limit;
+  order.volume = volume;
+  order.price = price;
+  order.stopPrice = stopPrice;
+  order.timestamp = timestamp;
+  const std::string result = exchange.registerOrder(order);
+  if (result.rfind("Order registration accepted", 0) != 0) {
+    std::cout << "order rejected: " << result << std::endl;
+    return false;
+  }
+  return true;
+}
+
+/**
+ * @brief Проверить срабатывание стоп-заявок при совмещении нескольких
+ * уровней цены.
+ * @return true-сработали нужные заявки, false-нет.
+ * @details Заявка на продажу 2@90 совмещается с заявками на покупку 1@101
+ * и 1@99. Первая сделка проходит по 101 и достигает цены срабатывания 100
+ * стоп-заявки на покупку 1@105: сработавшая заявка становится лучшей и
+ * забирает остаток продажи по 105, заявка 1@99 остаётся в "стакане".
+ * Прежде стоп-заявки сравнивались только с ценой последней сделки прохода
+ * (99) и не срабатывали. Стоп-заявка на продажу с ценой срабатывания 95
+ * срабатывать не должна: цена ниже 101 не опускалась.
+ */
+bool checkSweep() {
+  TradingExchangeClient exchange;
+  const std::size_t buyer = exchange.registerNewUser("buyer");
+  const std::size_t seller = exchange.registerNewUser("seller");
+  const std::size_t stopper = exchange.registerNewUser("stopper");
+  for (const std::size_t userId : {buyer, seller, stopper}) {
+    exchange.deposit(userId, common::currency::Currency_RU, 1000.f);
+    exchange.deposit(userId, common::currency::Currency_USD, 10.f);
+  }
+  if (!placeOrder(exchange, buyer, common::OrderType_Buy, 1.f, 101.f) ||
+      !placeOrder(exchange, buyer, common::OrderType_Buy, 1.f, 99.f) ||
+      !placeOrder(exchange, stopper, common::OrderType_Buy, 1.f, 105.f,
+                  100.f) ||
+      !placeOrder(exchange, stopper, common::OrderType_Sell, 1.f, 90.f,
+                  95.f) ||
+      !placeOrder(exchange, seller, common::OrderType_Sell, 2.f, 90.f)) {
+    return false;
+  }
+  exchange.process(timestamp);
+
+  const std::vector<Trade> trades = exchange.getTradeStore().getRecentTrades(
+      common::currency::Instrument_USD_RU, 10);
+  if ((trades.size() != 2) || (trades[1].price != 101.f) ||
+      (trades[0].price != 105.f)) {
+    std::cout << "buy stop at 100 did not fire after the trade at 101"
+              << std::endl;
+    return false;
+  }
+  const nlohmann::json book = nlohmann::json::parse(exchange.dumpState())
+                                  .at("books")
+                                  .at(common::currency::Instrument_USD_RU);
+  bool passed = true;
+  const nlohmann::json &buy = book.at("buy");
+  if (!book.at("buyStops").empty() || (buy.size() != 1) ||
+      (buy[0][1] != buyer) || (buy[0][2] != 99.f)) {
+    std::cout << "unexpected buy side: " << book.dump() << std::endl;
+    passed = false;
+  }
+  if (book.at("sellStops").size() != 1) {
+    std::cout << "sell stop at 95 fired above its stop price" << std::endl;
+    passed = false;
+  }
+  return passed;
+}
+
+} // namespace
+
+int main() {
+  const bool passed = checkSweep();
+  std::cout << (passed ? "passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
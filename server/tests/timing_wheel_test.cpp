@@ -0,0 +1,75 @@
+#include "timing_wheel.h"
+
+#include <iostream>
+#include <vector>
+
+namespace {
+
+/**
+ * @brief Проверить, что таймеры срабатывают точно на такте срока.
+ * @param start Такт, с которого начинается отсчёт.
+ * @return true-все таймеры сработали вовремя, false-нет.
+ * @details Сроки выбраны на границах ячеек всех уровней колеса (кратные
+ * 64, 64^2, 64^3 тактам), рядом с ними и за горизонтом колеса. Длительность
+ * такта - 1 нс, поэтому время равно номеру такта.
+ */
+bool checkBoundaries(std::int64_t start) {
+  const std::int64_t dueTicks[] = {
+      1,       63,      64,      65,      127,     128,      129,
+      4095,    4096,    4097,    8192,    86400,   2 * 86400, 262143,
+      262144,  262145,  300000,  16777215, 16777216, 16777221, 20000000};
+  TimingWheel<std::int64_t> wheel(1);
+  for (const std::int64_t due : dueTicks) {
+    wheel.schedule(start + due, start, start + due);
+  }
+  // Колесо продвигается до такта перед сроком и до такта срока: таймер
+  // должен сработать только во втором случае.
+  bool passed = true;
+  std::vector<std::int64_t> fired;
+  const auto collect = [&fired](std::int64_t due) { fired.push_back(due); };
+  for (const std::int64_t due : dueTicks) {
+    wheel.advance(start + due - 1, collect);
+    wheel.advance(start + due, collect);
+    if ((fired.size() != 1) || (fired.front() != start + due)) {
+      std::cout << "start " << start << ": timer due at " << due
+                << " fired late or early" << std::endl;
+      passed = false;
+    }
+    fired.clear();
+  }
+  return passed;
+}
+
+/**
+ * @brief Проверить, что просроченный таймер срабатывает на следующем такте.
+ * @return true-да, false-нет.
+ */
+bool checkOverdue() {
+  TimingWheel<int> wheel(1);
+  wheel.schedule(10, 10, 0);
+  wheel.advance(20, [](int) {});
+  int fired = 0;
+  wheel.schedule(5, 20, 1);
+  wheel.advance(20, [&fired](int) { ++fired; });
+  if (fired != 0) {
+    std::cout << "overdue timer fired on the current tick" << std::endl;
+    return false;
+  }
+  wheel.advance(21, [&fired](int) { ++fired; });
+  if (fired != 1) {
+    std::cout << "overdue timer did not fire on the next tick" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+} // namespace
+
+int main() {
+  bool passed = checkOverdue();
+  for (const std::int64_t start : {0, 37, 4090, 1792368000}) {
+    passed = checkBoundaries(start) && passed;
+  }
+  std::cout << (passed ? "passed" : "FAILED") << std::endl;
+  return passed ? 0 : 1;
+}
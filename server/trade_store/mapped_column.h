@@ -0,0 +1,150 @@
+#pragma once
+
+#include <atomic>
+#include <fcntl.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Столбец значений фиксированного размера, отображённый в память.
+ * @details Данные хранятся в файле (или в анонимном файле в памяти, если
+ * файл не задан). При нехватке места файл увеличивается вдвое и отображается
+ * заново. Прежние отображения освобождаются только при закрытии столбца,
+ * поэтому читатель из другого потока может пользоваться полученным ранее
+ * указателем на данные, пока не обращается за пределы размера, действовавшего
+ * при получении указателя.
+ * @tparam T Тип значения.
+ */
+template <typename T> class MappedColumn {
+public:
+  MappedColumn() = default;
+  MappedColumn(const MappedColumn &) = delete;
+  MappedColumn &operator=(const MappedColumn &) = delete;
+
+  /**
+   * @brief Деструктор.
+   */
+  ~MappedColumn() { close(); }
+
+  /**
+   * @brief Открыть файл столбца.
+   * @param path Путь к файлу (пусто - анонимная память).
+   * @details Существующие данные файла сохраняются.
+   */
+  void open(const std::string &path) {
+    close();
+    if (path.empty()) {
+      return;
+    }
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd_ < 0) {
+      throw std::runtime_error("Cannot open column file " + path);
+    }
+    struct stat fileStat;
+    ::fstat(fd_, &fileStat);
+    const std::size_t capacity =
+        static_cast<std::size_t>(fileStat.st_size) / sizeof(T);
+    if (capacity > 0) {
+      map(capacity);
+    }
+  }
+
+  /**
+   * @brief Обеспечить место под заданное количество значений.
+   * @param count Количество значений.
+   */
+  void reserve(std::size_t count) {
+    if (count <= capacity_) {
+      return;
+    }
+    std::size_t capacity = capacity_ > 0 ? capacity_ : initialCapacity;
+    while (capacity < count) {
+      capacity *= 2;
+    }
+    if (fd_ < 0) {
+      fd_ = ::memfd_create("column", 0);
+      if (fd_ < 0) {
+        throw std::runtime_error("Cannot create column");
+      }
+    }
+    if (::ftruncate(fd_, capacity * sizeof(T)) != 0) {
+      throw std::runtime_error("Cannot grow column file");
+    }
+    map(capacity);
+  }
+
+  /**
+   * @brief Данные столбца.
+   */
+  T *data() { return data_.load(std::memory_order_relaxed); }
+
+  /**
+   * @brief Данные столбца.
+   * @details Можно вызывать из потока чтения одновременно с добавлением
+   * значений.
+   */
+  const T *data() const { return data_.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Значение по индексу.
+   */
+  T &operator[](std::size_t index) { return data()[index]; }
+
+  /**
+   * @brief Значение по индексу.
+   */
+  const T &operator[](std::size_t index) const { return data()[index]; }
+
+private:
+  //! Начальное количество значений.
+  static constexpr std::size_t initialCapacity = 4096;
+
+  int fd_ = -1;                    //!< Дескриптор файла.
+  std::atomic<T *> data_ = nullptr; //!< Отображённые данные.
+  std::size_t capacity_ = 0; //!< Количество значений, помещающихся в память.
+  //! Прежние отображения (адрес и количество значений).
+  std::vector<std::pair<T *, std::size_t>> retired_;
+
+  /**
+   * @brief Отобразить столбец в память заданного размера.
+   * @param capacity Количество значений.
+   */
+  void map(std::size_t capacity) {
+    // Новое отображение того же файла видит те же данные, старое остаётся
+    // действительным для читателей.
+    void *data = ::mmap(nullptr, capacity * sizeof(T), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd_, 0);
+    if (data == MAP_FAILED) {
+      throw std::runtime_error("Cannot map column");
+    }
+    if (data_ != nullptr) {
+      retired_.emplace_back(data_, capacity_);
+    }
+    data_.store(static_cast<T *>(data), std::memory_order_release);
+    capacity_ = capacity;
+  }
+
+  /**
+   * @brief Закрыть столбец.
+   */
+  void close() {
+    for (const auto &[data, capacity] : retired_) {
+      ::munmap(data, capacity * sizeof(T));
+    }
+    retired_.clear();
+    if (data_ != nullptr) {
+      ::munmap(data_, capacity_ * sizeof(T));
+      data_ = nullptr;
+      capacity_ = 0;
+    }
+    if (fd_ >= 0) {
+      ::close(fd_);
+      fd_ = -1;
+    }
+  }
+};
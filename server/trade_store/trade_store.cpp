@@ -0,0 +1,141 @@
+#include "trade_store.h"
+
+#include <algorithm>
+
+TradeStore::TradeStore() {
+  count_.reserve(1);
+  previous_.reserve(1);
+}
+
+void TradeStore::open(const std::string &directory) {
+  count_.open(directory + "/count.col");
+  count_.reserve(1);
+  timestamps_.open(directory + "/timestamp.col");
+  instruments_.open(directory + "/instrument.col");
+  prices_.open(directory + "/price.col");
+  volumes_.open(directory + "/volume.col");
+  aggressors_.open(directory + "/aggressor.col");
+  timestamps_.reserve(size());
+  instruments_.reserve(size());
+  prices_.reserve(size());
+  volumes_.reserve(size());
+  aggressors_.reserve(size());
+  size_.store(count_[0], std::memory_order_release);
+  linkInstruments();
+}
+
+void TradeStore::linkInstruments() {
+  const std::size_t count = size();
+  previous_.reserve(count);
+  for (std::atomic<std::uint64_t> &last : last_) {
+    last.store(0, std::memory_order_relaxed);
+  }
+  for (std::size_t index = 0; index < count; ++index) {
+    std::atomic<std::uint64_t> &last = last_[instruments_[index]];
+    previous_[index] = last.load(std::memory_order_relaxed);
+    last.store(index + 1, std::memory_order_release);
+  }
+}
+
+void TradeStore::append(const Trade &trade) {
+  const std::size_t index = size_.load(std::memory_order_relaxed);
+  timestamps_.reserve(index + 1);
+  instruments_.reserve(index + 1);
+  prices_.reserve(index + 1);
+  volumes_.reserve(index + 1);
+  aggressors_.reserve(index + 1);
+  previous_.reserve(index + 1);
+  timestamps_[index] = trade.timestamp;
+  instruments_[index] = trade.instrument;
+  prices_[index] = trade.price;
+  volumes_[index] = trade.volume;
+  aggressors_[index] = static_cast<std::uint8_t>(trade.aggressor);
+  std::atomic<std::uint64_t> &last = last_[trade.instrument];
+  previous_[index] = last.load(std::memory_order_relaxed);
+  count_[0] = index + 1;
+  // Читатели видят сделку только после записи всех её столбцов.
+  last.store(index + 1, std::memory_order_release);
+  size_.store(index + 1, std::memory_order_release);
+}
+
+std::vector<Trade>
+TradeStore::getRecentTrades(common::currency::InstrumentId instrument,
+                            std::size_t limit, bool inverse) const {
+  std::vector<Trade> trades;
+  const std::size_t count = size();
+  std::uint64_t next = last_[instrument].load(std::memory_order_acquire);
+  // Столбцы читаются после ссылки на последнюю сделку: их отображения
+  // вмещают все сделки, на которые она ссылается.
+  const std::uint64_t *previous = previous_.data();
+  const std::int64_t *timestamps = timestamps_.data();
+  const float *prices = prices_.data();
+  const float *volumes = volumes_.data();
+  const std::uint8_t *aggressors = aggressors_.data();
+  // Сделки, добавленные после чтения количества, пропускаются.
+  while (next > count) {
+    next = previous[next - 1];
+  }
+  for (; (next != 0) && (trades.size() < limit); next = previous[next - 1]) {
+    const std::size_t index = next - 1;
+    Trade trade;
+    trade.timestamp = timestamps[index];
+    trade.instrument = instrument;
+    trade.price = prices[index];
+    trade.volume = volumes[index];
+    trade.aggressor = static_cast<common::OrderType>(aggressors[index]);
+    if (inverse) {
+      trade.volume *= trade.price;
+      trade.price = 1.f / trade.price;
+      trade.aggressor = trade.aggressor == common::OrderType_Buy
+                            ? common::OrderType_Sell
+                            : common::OrderType_Buy;
+    }
+    trades.push_back(trade);
+  }
+  return trades;
+}
+
+std::vector<Bar> TradeStore::getBars(common::currency::InstrumentId instrument,
+                                     std::int64_t from, std::int64_t to,
+                                     std::int64_t interval,
+                                     std::size_t maxBars,
+                                     bool inverse) const {
+  std::vector<Bar> bars;
+  const std::size_t count = size();
+  if ((interval <= 0) || (from >= to) || (count == 0) || (maxBars == 0)) {
+    return bars;
+  }
+  // Сделки добавляются в порядке времени, поэтому границы периода ищутся
+  // двоичным поиском по столбцу времени.
+  const std::int64_t *timestamps = timestamps_.data();
+  const std::size_t first =
+      std::lower_bound(timestamps, timestamps + count, from) - timestamps;
+  const std::size_t last =
+      std::lower_bound(timestamps + first, timestamps + count, to) -
+      timestamps;
+
+  const std::uint8_t *instruments = instruments_.data();
+  const float *prices = prices_.data();
+  const float *volumes = volumes_.data();
+  for (std::size_t index = first; index < last; ++index) {
+    if (instruments[index] != instrument) {
+      continue;
+    }
+    const std::int64_t start = timestamps[index] / interval * interval;
+    const float price = inverse ? 1.f / prices[index] : prices[index];
+    const float volume =
+        inverse ? volumes[index] * prices[index] : volumes[index];
+    if (bars.empty() || (bars.back().start != start)) {
+      if (bars.size() == maxBars) {
+        break;
+      }
+      bars.push_back(Bar{start, price, price, price, price, 0.f});
+    }
+    Bar &bar = bars.back();
+    bar.high = std::max(bar.high, price);
+    bar.low = std::min(bar.low, price);
+    bar.close = price;
+    bar.volume += volume;
+  }
+  return bars;
+}
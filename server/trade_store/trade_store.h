@@ -0,0 +1,118 @@
+#pragma once
+
+#include "common.h"
+#include "mapped_column.h"
+
+#include <array>
+#include <atomic>
+
+/**
+ * @brief Сделка.
+ */
+struct Trade {
+  std::int64_t timestamp = 0; //!< Время сделки (нс с начала эпохи).
+  //! Торговый инструмент.
+  common::currency::InstrumentId instrument = common::currency::InstrumentCount;
+  float price = 0.f;  //!< Цена.
+  float volume = 0.f; //!< Объём.
+  //! Сторона заявки-инициатора (более поздней заявки).
+  common::OrderType aggressor = common::OrderType_None;
+};
+
+/**
+ * @brief Свеча (OHLCV) за интервал.
+ */
+struct Bar {
+  std::int64_t start = 0; //!< Начало интервала.
+  float open = 0.f;       //!< Цена первой сделки.
+  float high = 0.f;       //!< Максимальная цена.
+  float low = 0.f;        //!< Минимальная цена.
+  float close = 0.f;      //!< Цена последней сделки.
+  float volume = 0.f;     //!< Суммарный объём.
+};
+
+/**
+ * @brief Лента сделок.
+ * @details Сделки только добавляются и хранятся по столбцам: время,
+ * инструмент, цена, объём и сторона инициатора лежат в отдельных
+ * отображённых в память файлах. Запросы просматривают только нужные столбцы.
+ * Сделки добавляются в потоке биржи, запросы можно выполнять из других
+ * потоков одновременно с добавлением: количество сделок публикуется после
+ * записи их столбцов.
+ */
+class TradeStore {
+public:
+  /**
+   * @brief Конструктор.
+   * @details Лента хранится в анонимной памяти до вызова open.
+   */
+  TradeStore();
+
+  /**
+   * @brief Открыть файлы ленты в каталоге.
+   * @param directory Каталог (должен существовать).
+   * @details Ранее записанные сделки сохраняются.
+   */
+  void open(const std::string &directory);
+
+  /**
+   * @brief Добавить сделку.
+   * @param trade Сделка.
+   */
+  void append(const Trade &trade);
+
+  /**
+   * @brief Количество сделок.
+   */
+  std::size_t size() const { return size_.load(std::memory_order_acquire); }
+
+  /**
+   * @brief Получить последние сделки по инструменту.
+   * @param instrument Инструмент.
+   * @param limit Максимальное количество сделок.
+   * @param inverse Пересчитать сделки для обратной пары (цена 1 / P, объём
+   * V * P, противоположная сторона).
+   * @return Сделки от новых к старым.
+   * @details Просматривает только сделки инструмента.
+   */
+  std::vector<Trade> getRecentTrades(common::currency::InstrumentId instrument,
+                                     std::size_t limit,
+                                     bool inverse = false) const;
+
+  /**
+   * @brief Получить свечи по инструменту.
+   * @param instrument Инструмент.
+   * @param from Начало периода (нс с начала эпохи).
+   * @param to Конец периода, не включая.
+   * @param interval Длительность свечи (нс).
+   * @param maxBars Максимальное количество свечей.
+   * @param inverse Пересчитать сделки для обратной пары.
+   * @return Первые свечи интервалов, в которых были сделки. Интервалы
+   * выровнены по кратному interval времени с начала эпохи.
+   */
+  std::vector<Bar> getBars(common::currency::InstrumentId instrument,
+                           std::int64_t from, std::int64_t to,
+                           std::int64_t interval, std::size_t maxBars,
+                           bool inverse = false) const;
+
+private:
+  MappedColumn<std::uint64_t> count_;     //!< Количество сделок.
+  MappedColumn<std::int64_t> timestamps_; //!< Время сделок.
+  MappedColumn<std::uint8_t> instruments_; //!< Инструменты.
+  MappedColumn<float> prices_;             //!< Цены.
+  MappedColumn<float> volumes_;            //!< Объёмы.
+  MappedColumn<std::uint8_t> aggressors_;  //!< Стороны инициаторов.
+  //! Предыдущая сделка того же инструмента (индекс + 1, 0 - нет). Хранится
+  //! в памяти и восстанавливается при открытии ленты.
+  MappedColumn<std::uint64_t> previous_;
+  //! Последняя сделка инструмента (индекс + 1, 0 - нет).
+  std::array<std::atomic<std::uint64_t>, common::currency::InstrumentCount>
+      last_ = {};
+  //! Опубликованное количество сделок.
+  std::atomic<std::size_t> size_ = 0;
+
+  /**
+   * @brief Восстановить ссылки на предыдущие сделки инструментов.
+   */
+  void linkInstruments();
+};
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "common.h"
+#include "page_memory.h"
+#include "tracking_allocator.h"
+
+#include <memory>
+#include <vector>
+
+//! Индекс записи в пуле заявок, аналог нулевого указателя.
+constexpr std::uint32_t nullOrderIndex = UINT32_MAX;
+
+/**
+ * @brief Компактная запись заявки, находящейся в "стакане".
+ * @details Единственный владелец данных заявки. Очередь уровня цены и список
+ * заявок пользователя связывают записи через индексы в пуле.
+ */
+struct OrderRecord {
+  std::uint64_t id = 0;        //!< Порядковый номер заявки.
+  std::int64_t timestamp = 0;  //!< Время регистрации заявки (нс).
+  float price = 0.f;           //!< Цена.
+  float volume = 0.f;          //!< Оставшийся видимый объём.
+  float reserve = 0.f;         //!< Скрытый объём заявки "айсберг".
+  float peak = 0.f;            //!< Видимая часть заявки "айсберг".
+  float stopPrice = 0.f;       //!< Цена срабатывания стоп-заявки.
+  std::uint32_t userIndex = 0; //!< ID пользователя.
+  //! Предыдущая заявка на уровне цены.
+  std::uint32_t levelPrev = nullOrderIndex;
+  //! Следующая заявка на уровне цены (или в списке свободных записей).
+  std::uint32_t levelNext = nullOrderIndex;
+  //! Предыдущая заявка пользователя.
+  std::uint32_t userPrev = nullOrderIndex;
+  //! Следующая заявка пользователя.
+  std::uint32_t userNext = nullOrderIndex;
+  //! Торговый инструмент "стакана" (канонический).
+  common::currency::InstrumentId instrument = common::currency::InstrumentCount;
+  //! Инструмент, в котором заявка выставлена клиентом.
+  common::currency::InstrumentId quotedInstrument =
+      common::currency::InstrumentCount;
+  std::uint8_t type = common::OrderType_None; //!< Тип заявки.
+  //! Вид заявки. Сработавшая стоп-заявка становится лимитной.
+  std::uint8_t kind = common::OrderKind_Limit;
+  //! Срок действия заявки.
+  std::uint8_t timeInForce = common::TimeInForce_GTC;
+};
+
+static_assert(sizeof(OrderRecord) <= 64,
+              "OrderRecord must fit into a cache line");
+
+/**
+ * @brief Пул записей заявок.
+ * @details Выделяет записи блоками фиксированного размера, освобождённые
+ * записи переиспользуются через список свободных. Индексы записей стабильны.
+ * Блоки можно выделить заранее, в том числе большими страницами, чтобы
+ * первые заявки не вызывали выделения памяти и отказов страниц.
+ */
+class OrderPool {
+public:
+  OrderPool() = default;
+  OrderPool(const OrderPool &) = delete;
+  OrderPool &operator=(const OrderPool &) = delete;
+
+  /**
+   * @brief Деструктор.
+   */
+  ~OrderPool() {
+    for (const PageMemory &memory : memory_) {
+      GlobalMemoryAccounting().released(MemorySubsystem_Books, memory.size());
+    }
+  }
+
+  /**
+   * @brief Выделить запись.
+   * @return Индекс записи.
+   */
+  std::uint32_t allocate() {
+    if (freeHead_ == nullOrderIndex) {
+      addSlab();
+    }
+    const std::uint32_t index = freeHead_;
+    freeHead_ = (*this)[index].levelNext;
+    (*this)[index] = OrderRecord();
+    ++size_;
+    return index;
+  }
+
+  /**
+   * @brief Освободить запись.
+   * @param index Индекс записи.
+   * @details Номер заявки в свободной записи равен 0, по нему отложенные
+   * ссылки на запись (например, таймеры) проверяют, что заявка ещё активна.
+   */
+  void release(std::uint32_t index) {
+    (*this)[index].id = 0;
+    (*this)[index].levelNext = freeHead_;
+    freeHead_ = index;
+    --size_;
+  }
+
+  /**
+   * @brief Получить запись по индексу.
+   * @param index Индекс записи.
+   * @return Запись.
+   */
+  OrderRecord &operator[](std::uint32_t index) {
+    return slabs_[index / slabSize][index % slabSize];
+  }
+
+  /**
+   * @brief Получить запись по индексу.
+   * @param index Индекс записи.
+   * @return Запись.
+   */
+  const OrderRecord &operator[](std::uint32_t index) const {
+    return slabs_[index / slabSize][index % slabSize];
+  }
+
+  /**
+   * @brief Количество занятых записей.
+   */
+  std::size_t size() const { return size_; }
+
+  /**
+   * @brief Количество выделенных записей (занятых и свободных).
+   */
+  std::size_t capacity() const { return slabs_.size() * slabSize; }
+
+  /**
+   * @brief Заранее выделить записи.
+   * @param count Требуемое количество записей.
+   * @param hugePages Выделять большими страницами.
+   * @return true-записи выделены большими страницами, false-обычными (или
+   * выделять не потребовалось).
+   */
+  bool reserve(std::size_t count, bool hugePages) {
+    if (count <= capacity()) {
+      return false;
+    }
+    const std::size_t slabCount =
+        (count - capacity() + slabSize - 1) / slabSize;
+    memory_.emplace_back(slabCount * slabSize * sizeof(OrderRecord),
+                         hugePages);
+    GlobalMemoryAccounting().allocated(MemorySubsystem_Books,
+                                       memory_.back().size());
+    OrderRecord *records = static_cast<OrderRecord *>(memory_.back().data());
+    // Первыми выдаются записи из начала выделенной памяти.
+    for (std::size_t slab = slabCount; slab > 0; --slab) {
+      addSlab(records + (slab - 1) * slabSize);
+    }
+    return memory_.back().isHuge();
+  }
+
+private:
+  //! Количество записей в блоке.
+  static constexpr std::uint32_t slabSize = 4096;
+
+  //! Блоки записей.
+  std::vector<OrderRecord *,
+              TrackingAllocator<OrderRecord *, MemorySubsystem_Books>>
+      slabs_;
+  std::vector<PageMemory> memory_; //!< Память блоков.
+  std::uint32_t freeHead_ = nullOrderIndex; //!< Первая свободная запись.
+  std::size_t size_ = 0;                    //!< Количество занятых записей.
+
+  /**
+   * @brief Выделить новый блок.
+   */
+  void addSlab() {
+    memory_.emplace_back(slabSize * sizeof(OrderRecord), false);
+    GlobalMemoryAccounting().allocated(MemorySubsystem_Books,
+                                       memory_.back().size());
+    addSlab(static_cast<OrderRecord *>(memory_.back().data()));
+  }
+
+  /**
+   * @brief Добавить записи блока в список свободных.
+   * @param records Память блока.
+   */
+  void addSlab(OrderRecord *records) {
+    std::uninitialized_default_construct_n(records, slabSize);
+    const std::uint32_t first =
+        static_cast<std::uint32_t>(slabs_.size()) * slabSize;
+    slabs_.push_back(records);
+    for (std::uint32_t i = slabSize; i > 0; --i) {
+      (*this)[first + i - 1].levelNext = freeHead_;
+      freeHead_ = first + i - 1;
+    }
+  }
+};
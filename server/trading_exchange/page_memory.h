@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <sys/mman.h>
+#include <utility>
+
+/**
+ * @brief Память, выделенная страницами операционной системы.
+ * @details Страницы отображаются сразу (MAP_POPULATE), поэтому обращения к
+ * памяти не вызывают отказов страниц. Если запрошены большие страницы, память
+ * сначала выделяется из пула huge pages (MAP_HUGETLB), а если он пуст -
+ * обычными страницами с пометкой для прозрачных больших страниц.
+ */
+class PageMemory {
+public:
+  //! Размер большой страницы.
+  static constexpr std::size_t hugePageSize = 2 * 1024 * 1024;
+
+  /**
+   * @brief Конструктор.
+   * @param size Размер памяти в байтах.
+   * @param hugePages Выделять большими страницами.
+   * @details Бросает std::bad_alloc, если память не выделена.
+   */
+  PageMemory(std::size_t size, bool hugePages) {
+    if (hugePages) {
+      size_ = (size + hugePageSize - 1) / hugePageSize * hugePageSize;
+      data_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE,
+                   -1, 0);
+      huge_ = data_ != MAP_FAILED;
+    }
+    if (!huge_) {
+      size_ = size;
+      data_ = mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE, -1, 0);
+      if (data_ == MAP_FAILED) {
+        data_ = nullptr;
+        throw std::bad_alloc();
+      }
+      if (hugePages) {
+        madvise(data_, size_, MADV_HUGEPAGE);
+      }
+    }
+  }
+
+  /**
+   * @brief Деструктор.
+   */
+  ~PageMemory() {
+    if (data_ != nullptr) {
+      munmap(data_, size_);
+    }
+  }
+
+  PageMemory(const PageMemory &) = delete;
+  PageMemory &operator=(const PageMemory &) = delete;
+
+  /**
+   * @brief Конструктор перемещения.
+   * @param other Перемещаемая память.
+   */
+  PageMemory(PageMemory &&other) noexcept
+      : data_(std::exchange(other.data_, nullptr)), size_(other.size_),
+        huge_(other.huge_) {}
+
+  PageMemory &operator=(PageMemory &&) = delete;
+
+  /**
+   * @brief Начало памяти.
+   */
+  void *data() const { return data_; }
+
+  /**
+   * @brief Размер отображения.
+   */
+  std::size_t size() const { return size_; }
+
+  /**
+   * @brief Выделена ли память из пула больших страниц.
+   */
+  bool isHuge() const { return huge_; }
+
+private:
+  void *data_ = nullptr; //!< Начало памяти.
+  std::size_t size_ = 0; //!< Размер отображения.
+  bool huge_ = false;    //!< Память из пула больших страниц.
+};
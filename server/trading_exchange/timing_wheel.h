@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Иерархическое колесо таймеров.
+ * @details Время делится на такты заданной длительности. Каждый уровень
+ * колеса содержит slotCount ячеек, ячейка уровня N охватывает slotCount^N
+ * тактов. При переходе младшего уровня через ноль записи очередной ячейки
+ * старшего уровня распределяются по младшим уровням. Продвижение колеса на
+ * один такт обрабатывает только записи, срок которых наступил, поэтому
+ * стоимость не зависит от общего количества таймеров. Сроки дальше
+ * горизонта колеса откладываются в ячейку на горизонте и переносятся
+ * повторно.
+ */
+template <typename T> class TimingWheel {
+public:
+  /**
+   * @brief Конструктор.
+   * @param resolution Длительность такта (нс).
+   */
+  explicit TimingWheel(std::int64_t resolution) : resolution_(resolution) {}
+
+  /**
+   * @brief Добавить таймер.
+   * @param expireTime Время срабатывания (нс с начала эпохи).
+   * @param now Текущее время (нс с начала эпохи), задаёт начало отсчёта при
+   * первом вызове.
+   * @param value Значение, передаваемое обработчику при срабатывании.
+   */
+  void schedule(std::int64_t expireTime, std::int64_t now, const T &value) {
+    if (currentTick_ < 0) {
+      currentTick_ = now / resolution_;
+    }
+    // Срок округляется вверх: таймер не срабатывает раньше времени.
+    // Наступивший срок обрабатывается на следующем такте.
+    insert(Entry{(expireTime + resolution_ - 1) / resolution_, value},
+           currentTick_ + 1);
+  }
+
+  /**
+   * @brief Продвинуть колесо до текущего времени.
+   * @param now Текущее время (нс с начала эпохи).
+   * @param handler Обработчик, вызывается для каждого сработавшего таймера.
+   */
+  template <typename Handler>
+  void advance(std::int64_t now, Handler &&handler) {
+    if (currentTick_ < 0) {
+      return;
+    }
+    const std::int64_t tick = now / resolution_;
+    while (currentTick_ < tick) {
+      ++currentTick_;
+      for (std::size_t level = levelCount - 1; level > 0; --level) {
+        if ((currentTick_ & ((std::int64_t(1) << (level * slotBits)) - 1)) ==
+            0) {
+          cascade(level);
+        }
+      }
+      std::vector<Entry> &slot = slots_[0][currentTick_ & slotMask];
+      std::vector<Entry> expired;
+      expired.swap(slot);
+      for (const Entry &entry : expired) {
+        if (entry.tick <= currentTick_) {
+          handler(entry.value);
+        } else {
+          insert(entry, currentTick_ + 1);
+        }
+      }
+    }
+  }
+
+  /**
+   * @brief Обойти ожидающие таймеры.
+   * @param handler Обработчик, вызывается со временем срабатывания (нс с
+   * начала эпохи, округлённым до такта) и значением каждого таймера.
+   */
+  template <typename Handler> void forEach(Handler &&handler) const {
+    for (const auto &level : slots_) {
+      for (const std::vector<Entry> &slot : level) {
+        for (const Entry &entry : slot) {
+          handler(entry.tick * resolution_, entry.value);
+        }
+      }
+    }
+  }
+
+private:
+  //! Количество бит номера ячейки.
+  static constexpr std::size_t slotBits = 6;
+  //! Количество ячеек уровня.
+  static constexpr std::size_t slotCount = std::size_t(1) << slotBits;
+  //! Маска номера ячейки.
+  static constexpr std::int64_t slotMask = slotCount - 1;
+  //! Количество уровней.
+  static constexpr std::size_t levelCount = 4;
+
+  /**
+   * @brief Таймер.
+   */
+  struct Entry {
+    std::int64_t tick; //!< Такт срабатывания.
+    T value;           //!< Значение.
+  };
+
+  /**
+   * @brief Поместить таймер в ячейку уровня, соответствующего его сроку.
+   * @param entry Таймер.
+   * @param minTick Наименьший такт, в ячейку которого можно поместить
+   * таймер. Ячейка текущего такта допустима только при переносе со
+   * старшего уровня: она обрабатывается после переноса.
+   */
+  void insert(const Entry &entry, std::int64_t minTick) {
+    const std::int64_t tick = std::max(entry.tick, minTick);
+    const std::int64_t delta = tick - currentTick_;
+    for (std::size_t level = 0; level < levelCount; ++level) {
+      if ((delta >> ((level + 1) * slotBits)) == 0) {
+        slots_[level][(tick >> (level * slotBits)) & slotMask].push_back(
+            entry);
+        return;
+      }
+    }
+    // За горизонтом колеса: таймер будет перенесён при обходе ячейки.
+    constexpr std::size_t top = levelCount - 1;
+    const std::int64_t horizon =
+        currentTick_ + (std::int64_t(slotMask) << (top * slotBits));
+    slots_[top][(horizon >> (top * slotBits)) & slotMask].push_back(entry);
+  }
+
+  /**
+   * @brief Распределить таймеры текущей ячейки уровня по младшим уровням.
+   * @param level Уровень.
+   */
+  void cascade(std::size_t level) {
+    std::vector<Entry> entries;
+    entries.swap(
+        slots_[level][(currentTick_ >> (level * slotBits)) & slotMask]);
+    for (const Entry &entry : entries) {
+      // Таймер со сроком на текущем такте попадает в его ячейку и
+      // срабатывает вовремя, а не тактом позже.
+      insert(entry, currentTick_);
+    }
+  }
+
+  std::int64_t resolution_;       //!< Длительность такта (нс).
+  std::int64_t currentTick_ = -1; //!< Последний обработанный такт.
+  //! Ячейки таймеров по уровням.
+  std::array<std::array<std::vector<Entry>, slotCount>, levelCount> slots_;
+};
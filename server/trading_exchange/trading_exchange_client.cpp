@@ -1,125 +1,996 @@
 #include "trading_exchange_client.h"
 
-void TradingExchangeClient::process() { matchOrders(); }
+#include <cmath>
+#include <unordered_map>
 
-void TradingExchangeClient::matchOrders() {
-  if (orderBookToBuy_.empty() || orderBookToSell_.empty()) {
-    return;
+void TradingExchangeClient::process(std::int64_t timestamp) {
+  expireOrders(timestamp);
+  matchOrders(timestamp);
+}
+
+void TradingExchangeClient::reserveOrders(std::size_t count, bool hugePages) {
+  const bool huge = orderPool_.reserve(count, hugePages);
+  std::cout << "Order pool: " << orderPool_.capacity() << " records"
+            << (huge ? " in huge pages" : "") << std::endl;
+}
+
+TradeStore &TradingExchangeClient::getTradeStore() { return tradeStore_; }
+
+namespace {
+
+/**
+ * @brief Округлить сумму до заданного количества знаков после запятой.
+ * @tparam Precision Количество знаков после запятой.
+ * @param value Сумма.
+ * @return Округлённая сумма.
+ */
+template <int Precision> float roundToPrecision(float value) {
+  constexpr float scale = [] {
+    float result = 1.f;
+    for (int i = 0; i < Precision; ++i) {
+      result *= 10.f;
+    }
+    return result;
+  }();
+  return std::round(value * scale) / scale;
+}
+
+/**
+ * @brief Проверить, что цена кратна шагу цены инструмента.
+ * @param price Цена.
+ * @param tickSize Шаг цены.
+ * @return true-да, false-нет.
+ */
+bool isOnTick(float price, float tickSize) {
+  const float ticks = price / tickSize;
+  return std::fabs(ticks - std::round(ticks)) < 1e-3f;
+}
+
+/**
+ * @brief Получить противоположную сторону заявки.
+ * @param type Тип заявки.
+ * @return Противоположный тип заявки.
+ */
+std::uint8_t oppositeType(std::uint8_t type) {
+  return type == common::OrderType_Buy ? common::OrderType_Sell
+                                       : common::OrderType_Buy;
+}
+
+/**
+ * @brief Определить средства, резервируемые под заявку.
+ * @param instrument Инструмент заявки.
+ * @param type Тип заявки.
+ * @param price Цена.
+ * @param volume Объём.
+ * @return Валюта и сумма резерва.
+ */
+std::pair<common::currency::CurrencyId, float>
+requiredFunds(const common::currency::Instrument &instrument,
+              std::uint8_t type, float price, float volume) {
+  if (type == common::OrderType_Buy) {
+    return {instrument.quote, price * volume};
+  }
+  return {instrument.base, volume};
+}
+
+/**
+ * @brief Определить цену исполнения стоп-заявки.
+ * @param type Тип заявки.
+ * @param stopPrice Цена срабатывания.
+ * @param tickSize Шаг цены.
+ * @return Худшая допустимая цена исполнения, кратная шагу цены.
+ * @details Стоп-заявка исполняется по рынку в пределах допустимого
+ * отклонения от цены срабатывания, оно же ограничивает резерв средств.
+ */
+float stopExecutionPrice(std::uint8_t type, float stopPrice, float tickSize) {
+  if (type == common::OrderType_Buy) {
+    return std::ceil(stopPrice * (1.f + limits::stopPriceBand) / tickSize) *
+           tickSize;
+  }
+  return std::max(
+      tickSize,
+      std::floor(stopPrice * (1.f - limits::stopPriceBand) / tickSize) *
+          tickSize);
+}
+
+/**
+ * @brief Проверить, что заявка - ещё не сработавшая стоп-заявка.
+ * @param record Запись заявки.
+ * @return true-да, false-нет.
+ */
+bool isPendingStop(const OrderRecord &record) {
+  return (record.kind == common::OrderKind_Stop) ||
+         (record.kind == common::OrderKind_StopLimit);
+}
+
+/**
+ * @brief Сравнить суммы с допуском на погрешность вычислений.
+ * @param lhs Первая сумма.
+ * @param rhs Вторая сумма.
+ * @return true-суммы совпадают, false-нет.
+ */
+bool nearlyEqual(float lhs, float rhs) {
+  return std::fabs(lhs - rhs) <=
+         1e-3f * std::max({1.f, std::fabs(lhs), std::fabs(rhs)});
+}
+
+} // namespace
+
+void TradingExchangeClient::matchOrders(std::int64_t timestamp) {
+  matchOrderBooks(
+      timestamp, std::make_index_sequence<common::currency::InstrumentCount>());
+}
+
+template <std::size_t... Ids>
+void TradingExchangeClient::matchOrderBooks(std::int64_t timestamp,
+                                            std::index_sequence<Ids...>) {
+  (matchOrderBook<static_cast<common::currency::InstrumentId>(Ids)>(timestamp),
+   ...);
+}
+
+template <std::size_t... Ids>
+void TradingExchangeClient::matchOrderBookById(
+    common::currency::InstrumentId id, std::int64_t timestamp,
+    std::index_sequence<Ids...>) {
+  ((id == Ids
+        ? matchOrderBook<static_cast<common::currency::InstrumentId>(Ids)>(
+              timestamp)
+        : void()),
+   ...);
+}
+
+bool TradingExchangeClient::hasLiquidity(const OrderBook &orderBook,
+                                         std::uint8_t type, float price,
+                                         float volume) const {
+  float available = 0.f;
+  if (type == common::OrderType_Buy) {
+    for (auto levelIt = orderBook.toSell.cbegin();
+         (levelIt != orderBook.toSell.cend()) && (levelIt->first <= price);
+         ++levelIt) {
+      available += levelIt->second.volume;
+      if (available >= volume) {
+        return true;
+      }
+    }
+  } else {
+    for (auto levelIt = orderBook.toBuy.cbegin();
+         (levelIt != orderBook.toBuy.cend()) && (levelIt->first >= price);
+         ++levelIt) {
+      available += levelIt->second.volume;
+      if (available >= volume) {
+        return true;
+      }
+    }
   }
+  return false;
+}
 
-  common::Order orderToSell = *orderBookToSell_.begin();
-  common::Order orderToBuy = *orderBookToBuy_.begin();
-  common::CurrencyTypeValue price(orderToSell.price.first, 0.f);
-  common::CurrencyTypeValue volume(orderToSell.volume.first, 0.f);
-  if ((orderToSell.volume.first != orderToBuy.volume.first) ||
-      (orderToSell.price.first != orderToBuy.price.first)) {
+void TradingExchangeClient::expireOrders(std::int64_t timestamp) {
+  expiries_.advance(timestamp, [this](const Expiry &expiry) {
+    if (orderPool_[expiry.index].id == expiry.id) {
+      eraseOrder(expiry.index);
+    }
+  });
+}
+
+template <common::currency::InstrumentId Id>
+void TradingExchangeClient::matchOrderBook(std::int64_t timestamp) {
+  constexpr const common::currency::Instrument &instrument =
+      common::currency::instruments[Id];
+  if constexpr (instrument.canonical != Id) {
+    // Заявки обратной пары находятся в "стакане" прямой пары.
     return;
   }
+  OrderBook &orderBook = orderBooks_[Id];
 
-  if (orderToBuy.price.second >= orderToSell.price.second) {
-    cancelOrder(orderToSell);
-    cancelOrder(orderToBuy);
-    if (orderToSell.volume.second > orderToBuy.volume.second) {
-      orderToSell.volume.second -= orderToBuy.volume.second;
-      price.second = orderToBuy.price.second * orderToBuy.volume.second;
-      volume.second = orderToBuy.volume.second;
-      registerOrder(orderToSell);
-    } else if (orderToSell.volume.second < orderToBuy.volume.second) {
-      orderToBuy.volume.second -= orderToSell.volume.second;
-      volume.second = orderToSell.volume.second;
-      price.second = orderToBuy.price.second * orderToSell.volume.second;
-      registerOrder(orderToBuy);
+  // Стоп-заявки, зарегистрированные после последней сделки, сравниваются с
+  // её ценой.
+  triggerStops(orderBook, orderBook.lastPrice);
+  while (!orderBook.toBuy.empty() && !orderBook.toSell.empty()) {
+    const auto buyLevelIt = orderBook.toBuy.begin();
+    const auto sellLevelIt = orderBook.toSell.begin();
+    if (buyLevelIt->first < sellLevelIt->first) {
+      break;
     }
-    withdraw(orderToSell.userID, volume);
-    deposit(orderToBuy.userID, volume);
 
-    std::cout << orderToBuy.price.second << " " << price.second << std::endl;
-    deposit(orderToSell.userID, price);
-    withdraw(orderToBuy.userID, price);
+    const std::uint32_t buyIndex = buyLevelIt->second.head;
+    const std::uint32_t sellIndex = sellLevelIt->second.head;
+    const OrderRecord &orderToBuy = orderPool_[buyIndex];
+    const OrderRecord &orderToSell = orderPool_[sellIndex];
+    const float volume = std::min(orderToSell.volume, orderToBuy.volume);
+    const float price =
+        roundToPrecision<instrument.precision>(orderToBuy.price * volume);
+    const std::size_t buyer = orderToBuy.userIndex;
+    const std::size_t seller = orderToSell.userIndex;
+    orderBook.lastPrice = orderToBuy.price;
+    tradeStore_.append(Trade{timestamp, Id, orderToBuy.price, volume,
+                             orderToBuy.id > orderToSell.id
+                                 ? common::OrderType_Buy
+                                 : common::OrderType_Sell});
+
+    // Полностью исполненная заявка удаляется вместе с опустевшим уровнем.
+    fillOrder(buyIndex, buyLevelIt->second, volume);
+    fillOrder(sellIndex, sellLevelIt->second, volume);
+    changeBalance(seller, instrument.base, -volume);
+    changeBalance(buyer, instrument.base, volume);
+    changeBalance(seller, instrument.quote, price);
+    changeBalance(buyer, instrument.quote, -price);
+    // Каждая сделка может достичь цены срабатывания стоп-заявок, в том числе
+    // на промежуточном уровне цены: сработавшие заявки участвуют в
+    // дальнейшем совмещении.
+    triggerStops(orderBook, orderBook.lastPrice);
   }
 }
 
-std::string
+std::size_t
 TradingExchangeClient::registerNewUser(const std::string &userName) {
-  for (const auto &userPair : users) {
-    if (userPair.second.name == userName) {
-      return userPair.second.userId;
-    }
-  }
-  size_t newUserId = users.size();
-  users[newUserId].name = userName;
-  users[newUserId].userId = std::to_string(newUserId);
-  for (const std::string currency : common::currency::currencyTypes) {
-    users[newUserId].balance[currency] = 0.f;
+  const std::size_t userId = findUser(userName);
+  if (userId != common::unknownUser) {
+    return userId;
   }
+  users.emplace_back().name = userName;
+  userViews_.emplace_back();
 
-  return std::to_string(newUserId);
+  return users.size() - 1;
 }
 
 TradingExchangeClient::User
-TradingExchangeClient::getUserById(const std::string &userId) {
-  const auto userIt = users.find(std::stoi(userId));
-  if (userIt == users.cend()) {
+TradingExchangeClient::getUserById(std::size_t userId) const {
+  if (userId >= users.size()) {
     std::cout << "Error! Unknown User" << std::endl;
     User unknownUser;
     return unknownUser;
   } else {
-    return userIt->second;
+    return users[userId];
   }
 }
 
-TradingExchangeClient::User
-TradingExchangeClient::getUserByName(const std::string &userName) {
-  for (const auto &userPair : users) {
-    if (userPair.second.name == userName) {
-      return userPair.second;
+std::size_t
+TradingExchangeClient::findUser(const std::string &userName) const {
+  for (std::size_t userId = 0; userId < users.size(); ++userId) {
+    if (users[userId].name == userName) {
+      return userId;
     }
   }
-  return User();
+  return common::unknownUser;
+}
+
+std::vector<common::Order>
+TradingExchangeClient::getUserOrders(std::size_t userId) {
+  std::vector<common::Order> orders;
+  if (userId >= users.size()) {
+    return orders;
+  }
+  orders.reserve(users[userId].ordersCount);
+  for (std::uint32_t index = users[userId].ordersHead;
+       index != nullOrderIndex; index = orderPool_[index].userNext) {
+    orders.push_back(toOrder(orderPool_[index]));
+  }
+  return orders;
+}
+
+std::string TradingExchangeClient::getUserBalance(std::size_t userId) {
+  if (userId >= users.size()) {
+    return User().name;
+  }
+  return std::string(userViews_[userId].getBalance(users[userId].balance));
+}
+
+void TradingExchangeClient::writeUserOrders(
+    std::size_t userId, const OrdersQuery &query,
+    const std::function<void(std::string)> &sink) {
+  if (userId >= userViews_.size()) {
+    sink(User().name);
+    return;
+  }
+  // Список заявок пользователя упорядочен по номерам: заявки добавляются
+  // в конец при регистрации.
+  UserView::writeOrders(
+      query,
+      [this, userId](auto &&handler) {
+        for (std::uint32_t index = users[userId].ordersHead;
+             index != nullOrderIndex; index = orderPool_[index].userNext) {
+          if (!handler(toOrder(orderPool_[index]))) {
+            return;
+          }
+        }
+      },
+      sink);
 }
 
 std::string TradingExchangeClient::registerOrder(const common::Order &order) {
-  User user = getUserById(order.userID);
-  if (user.name != "Unknown User") {
-    order.type == common::OrderType_Buy ? orderBookToBuy_.insert(order)
-                                        : orderBookToSell_.insert(order);
-    users.find(std::stoi(order.userID))->second.orders.insert(order);
-    return "Order registration accepted";
+  if (order.instrument >= common::currency::InstrumentCount) {
+    return "Unknown currency pair";
+  }
+  if ((order.type != common::OrderType_Buy) &&
+      (order.type != common::OrderType_Sell)) {
+    return "Invalid order";
+  }
+  const float tickSize =
+      common::currency::instruments[order.instrument].tickSize;
+  const bool isStop = (order.kind == common::OrderKind_Stop) ||
+                      (order.kind == common::OrderKind_StopLimit);
+  if (isStop &&
+      ((order.stopPrice <= 0.f) || !isOnTick(order.stopPrice, tickSize))) {
+    return "Invalid stop price";
+  }
+  const float orderPrice =
+      order.kind == common::OrderKind_Stop
+          ? stopExecutionPrice(order.type, order.stopPrice, tickSize)
+          : order.price;
+  if (!isOnTick(orderPrice, tickSize)) {
+    return "Price is not a multiple of tick size";
+  }
+  if ((order.volume <= 0.f) || (orderPrice <= 0.f) ||
+      (order.kind > common::OrderKind_Iceberg)) {
+    return "Invalid order";
+  }
+  if ((order.kind == common::OrderKind_Iceberg) &&
+      ((order.peak <= 0.f) || (order.peak > order.volume))) {
+    return "Invalid iceberg peak";
+  }
+  const bool isImmediate = (order.timeInForce == common::TimeInForce_IOC) ||
+                           (order.timeInForce == common::TimeInForce_FOK);
+  if ((order.timeInForce > common::TimeInForce_GTD) ||
+      (isStop && isImmediate)) {
+    return "Invalid time in force";
+  }
+  if ((order.timeInForce == common::TimeInForce_GTD) &&
+      (order.expireTime <= order.timestamp)) {
+    return "Invalid expire time";
   }
-  return user.name;
+  if (order.userID < users.size()) {
+    User &user = users[order.userID];
+    // Заявка по обратной паре переводится в "стакан" прямой пары: покупка
+    // V единиц по цене P становится продажей V * P единиц по цене 1 / P.
+    const common::currency::Instrument &instrument =
+        common::currency::instruments[order.instrument];
+    const bool inverted = instrument.canonical != instrument.id;
+    const std::uint8_t type = inverted
+                                  ? oppositeType(order.type)
+                                  : static_cast<std::uint8_t>(order.type);
+    const float price = inverted ? 1.f / orderPrice : orderPrice;
+    const float volume = inverted ? order.volume * orderPrice : order.volume;
+    if (user.ordersCount >= limits::maxOpenOrders) {
+      return "Open orders limit exceeded";
+    }
+    const float notional = price * volume;
+    if (user.openNotional + notional > limits::maxOpenNotional) {
+      return "Open notional limit exceeded";
+    }
+    const auto [currency, amount] =
+        requiredFunds(common::currency::instruments[instrument.canonical],
+                      type, price, volume);
+    if (user.balance[currency] - user.reserved[currency] < amount) {
+      return "Insufficient funds";
+    }
+    if (order.timeInForce == common::TimeInForce_FOK) {
+      // Между тактами "стакан" может быть пересечён, и заявки той же
+      // стороны с лучшей ценой исполнились бы раньше FOK. Их совмещение
+      // выполняется до проверки объёма встречных заявок, но только для
+      // заявки, прошедшей все остальные проверки: отклонённая заявка не
+      // должна совершать сделки.
+      matchOrderBookById(
+          instrument.canonical, order.timestamp,
+          std::make_index_sequence<common::currency::InstrumentCount>());
+      if (!hasLiquidity(orderBooks_[instrument.canonical], type, price,
+                        volume)) {
+        return "Order killed: insufficient liquidity";
+      }
+    }
+    user.reserved[currency] += amount;
+    user.openNotional += notional;
+
+    const std::uint32_t index = orderPool_.allocate();
+    OrderRecord &record = orderPool_[index];
+    record.id = ++lastOrderId_;
+    record.timestamp = order.timestamp;
+    record.price = price;
+    record.volume = volume;
+    record.kind = order.kind;
+    if (isStop) {
+      record.stopPrice = inverted ? 1.f / order.stopPrice : order.stopPrice;
+    }
+    if (order.kind == common::OrderKind_Iceberg) {
+      record.peak = inverted ? order.peak * orderPrice : order.peak;
+      record.volume = std::min(record.peak, volume);
+      record.reserve = volume - record.volume;
+    }
+    record.userIndex = static_cast<std::uint32_t>(order.userID);
+    record.instrument = instrument.canonical;
+    record.quotedInstrument = order.instrument;
+    record.type = type;
+    record.timeInForce = order.timeInForce;
+    const std::uint64_t id = record.id;
+    insertOrder(index);
+
+    if (isImmediate) {
+      matchOrderBookById(
+          instrument.canonical, order.timestamp,
+          std::make_index_sequence<common::currency::InstrumentCount>());
+      if (orderPool_[index].id == id) {
+        eraseOrder(index);
+      }
+    } else if (order.timeInForce == common::TimeInForce_DAY) {
+      constexpr std::int64_t day = 86400ll * 1000000000ll;
+      expiries_.schedule((order.timestamp / day + 1) * day, order.timestamp,
+                         Expiry{index, id});
+    } else if (order.timeInForce == common::TimeInForce_GTD) {
+      expiries_.schedule(order.expireTime, order.timestamp,
+                         Expiry{index, id});
+    }
+    return "Order registration accepted. Order id: " + std::to_string(id);
+  }
+  return User().name;
 }
 
 std::string TradingExchangeClient::cancelOrder(const common::Order &order) {
-  User user = getUserById(order.userID);
-  if (user.name != "Unknown User") {
-    order.type == common::OrderType_Buy ? orderBookToBuy_.erase(order)
-                                        : orderBookToSell_.erase(order);
-    users.find(std::stoi(order.userID))->second.orders.erase(order);
-    return "Order cancel accepted";
+  if (order.userID < users.size()) {
+    for (std::uint32_t index = users[order.userID].ordersHead;
+         index != nullOrderIndex;
+         index = orderPool_[index].userNext) {
+      if (orderPool_[index].id == order.id) {
+        eraseOrder(index);
+        return "Order cancel accepted. Order id: " + std::to_string(order.id);
+      }
+    }
+    return "Order not found";
   }
-  return user.name;
+  return User().name;
+}
+
+void TradingExchangeClient::insertOrder(std::uint32_t index) {
+  OrderRecord &record = orderPool_[index];
+  if (!isPendingStop(record)) {
+    linkToLevel(index);
+  } else if (record.type == common::OrderType_Buy) {
+    orderBooks_[record.instrument].buyStops.emplace(record.stopPrice, index);
+  } else {
+    orderBooks_[record.instrument].sellStops.emplace(record.stopPrice, index);
+  }
+
+  User &user = users[record.userIndex];
+  record.userPrev = user.ordersTail;
+  record.userNext = nullOrderIndex;
+  if (user.ordersTail == nullOrderIndex) {
+    user.ordersHead = index;
+  } else {
+    orderPool_[user.ordersTail].userNext = index;
+  }
+  user.ordersTail = index;
+  ++user.ordersCount;
+}
+
+void TradingExchangeClient::linkToLevel(std::uint32_t index) {
+  OrderRecord &record = orderPool_[index];
+  OrderBook &orderBook = orderBooks_[record.instrument];
+  PriceLevel &level = record.type == common::OrderType_Buy
+                          ? orderBook.toBuy[record.price]
+                          : orderBook.toSell[record.price];
+  record.levelPrev = level.tail;
+  record.levelNext = nullOrderIndex;
+  if (level.tail == nullOrderIndex) {
+    level.head = index;
+  } else {
+    orderPool_[level.tail].levelNext = index;
+  }
+  level.tail = index;
+  level.volume += record.volume;
+}
+
+void TradingExchangeClient::triggerStops(OrderBook &orderBook,
+                                         float tradePrice) {
+  if ((orderBook.buyStops.empty() && orderBook.sellStops.empty()) ||
+      (tradePrice <= 0.f)) {
+    return;
+  }
+  const auto trigger = [this](auto &stops, auto isCrossed) {
+    while (!stops.empty() && isCrossed(stops.begin()->first)) {
+      const std::uint32_t index = stops.begin()->second;
+      stops.erase(stops.begin());
+      OrderRecord &record = orderPool_[index];
+      record.kind = common::OrderKind_Limit;
+      linkToLevel(index);
+    }
+  };
+  trigger(orderBook.buyStops,
+          [tradePrice](float stopPrice) { return stopPrice <= tradePrice; });
+  trigger(orderBook.sellStops,
+          [tradePrice](float stopPrice) { return stopPrice >= tradePrice; });
+}
+
+void TradingExchangeClient::eraseOrder(std::uint32_t index) {
+  OrderRecord &record = orderPool_[index];
+  OrderBook &orderBook = orderBooks_[record.instrument];
+  releaseReserve(record, record.volume + record.reserve);
+  if (isPendingStop(record)) {
+    if (record.type == common::OrderType_Buy) {
+      unlinkFromStops(orderBook.buyStops, index);
+    } else {
+      unlinkFromStops(orderBook.sellStops, index);
+    }
+  } else if (record.type == common::OrderType_Buy) {
+    unlinkFromLevel(orderBook.toBuy, index);
+  } else {
+    unlinkFromLevel(orderBook.toSell, index);
+  }
+
+  User &user = users[record.userIndex];
+  if (record.userPrev == nullOrderIndex) {
+    user.ordersHead = record.userNext;
+  } else {
+    orderPool_[record.userPrev].userNext = record.userNext;
+  }
+  if (record.userNext == nullOrderIndex) {
+    user.ordersTail = record.userPrev;
+  } else {
+    orderPool_[record.userNext].userPrev = record.userPrev;
+  }
+  --user.ordersCount;
+  if (user.ordersCount == 0) {
+    // Сбрасываем накопленную погрешность вычислений с плавающей точкой.
+    user.reserved = {};
+    user.openNotional = 0.f;
+  }
+  orderPool_.release(index);
+}
+
+void TradingExchangeClient::fillOrder(std::uint32_t index, PriceLevel &level,
+                                      float volume) {
+  OrderRecord &record = orderPool_[index];
+  releaseReserve(record, volume);
+  record.volume -= volume;
+  level.volume -= volume;
+  if ((record.volume <= 0.f) && (record.reserve > 0.f)) {
+    // Пополнение "айсберга": заявка теряет приоритет и переходит в конец
+    // очереди своего уровня без поиска уровня в "стакане".
+    if (level.tail != index) {
+      if (record.levelPrev == nullOrderIndex) {
+        level.head = record.levelNext;
+      } else {
+        orderPool_[record.levelPrev].levelNext = record.levelNext;
+      }
+      orderPool_[record.levelNext].levelPrev = record.levelPrev;
+      record.levelPrev = level.tail;
+      record.levelNext = nullOrderIndex;
+      orderPool_[level.tail].levelNext = index;
+      level.tail = index;
+    }
+    record.volume = std::min(record.peak, record.reserve);
+    record.reserve -= record.volume;
+    level.volume += record.volume;
+  }
+  if (record.volume <= 0.f) {
+    eraseOrder(index);
+  }
+}
+
+void TradingExchangeClient::releaseReserve(const OrderRecord &record,
+                                           float volume) {
+  User &user = users[record.userIndex];
+  const auto [currency, amount] =
+      requiredFunds(common::currency::instruments[record.instrument],
+                    record.type, record.price, volume);
+  user.reserved[currency] -= amount;
+  user.openNotional -= record.price * volume;
+}
+
+template <typename Levels>
+void TradingExchangeClient::unlinkFromLevel(Levels &levels,
+                                            std::uint32_t index) {
+  const OrderRecord &record = orderPool_[index];
+  const auto levelIt = levels.find(record.price);
+  PriceLevel &level = levelIt->second;
+  if (record.levelPrev == nullOrderIndex) {
+    level.head = record.levelNext;
+  } else {
+    orderPool_[record.levelPrev].levelNext = record.levelNext;
+  }
+  if (record.levelNext == nullOrderIndex) {
+    level.tail = record.levelPrev;
+  } else {
+    orderPool_[record.levelNext].levelPrev = record.levelPrev;
+  }
+  level.volume -= record.volume;
+  if (level.head == nullOrderIndex) {
+    levels.erase(levelIt);
+  }
+}
+
+template <typename Stops>
+void TradingExchangeClient::unlinkFromStops(Stops &stops,
+                                            std::uint32_t index) {
+  auto [stopIt, stopEnd] = stops.equal_range(orderPool_[index].stopPrice);
+  for (; stopIt != stopEnd; ++stopIt) {
+    if (stopIt->second == index) {
+      stops.erase(stopIt);
+      return;
+    }
+  }
+}
+
+std::string TradingExchangeClient::dumpState() {
+  nlohmann::json state;
+  state["lastOrderId"] = lastOrderId_;
+  nlohmann::json &usersState = state["users"];
+  usersState = nlohmann::json::array();
+  for (std::size_t userId = 0; userId < users.size(); ++userId) {
+    usersState.push_back({{"id", userId},
+                          {"name", users[userId].name},
+                          {"balance", users[userId].balance},
+                          {"reserved", users[userId].reserved}});
+  }
+  nlohmann::json &booksState = state["books"];
+  booksState = nlohmann::json::array();
+  for (const OrderBook &orderBook : orderBooks_) {
+    const auto dumpLevels = [this](const auto &levels) {
+      nlohmann::json orders = nlohmann::json::array();
+      for (const auto &levelPair : levels) {
+        for (std::uint32_t index = levelPair.second.head;
+             index != nullOrderIndex; index = orderPool_[index].levelNext) {
+          const OrderRecord &record = orderPool_[index];
+          orders.push_back({record.id, record.userIndex, record.price,
+                            record.volume, record.reserve});
+        }
+      }
+      return orders;
+    };
+    const auto dumpStops = [this](const auto &stops) {
+      nlohmann::json orders = nlohmann::json::array();
+      for (const auto &stopPair : stops) {
+        const OrderRecord &record = orderPool_[stopPair.second];
+        orders.push_back({record.id, record.userIndex, record.stopPrice,
+                          record.price, record.volume});
+      }
+      return orders;
+    };
+    booksState.push_back({{"buy", dumpLevels(orderBook.toBuy)},
+                          {"sell", dumpLevels(orderBook.toSell)},
+                          {"buyStops", dumpStops(orderBook.buyStops)},
+                          {"sellStops", dumpStops(orderBook.sellStops)}});
+  }
+  return state.dump();
+}
+
+nlohmann::json TradingExchangeClient::saveSnapshot() const {
+  nlohmann::json snapshot;
+  snapshot["lastOrderId"] = lastOrderId_;
+  snapshot["externalBalance"] = externalBalance_;
+  nlohmann::json &usersState = snapshot["users"];
+  usersState = nlohmann::json::array();
+  for (const User &user : users) {
+    nlohmann::json orders = nlohmann::json::array();
+    for (std::uint32_t index = user.ordersHead; index != nullOrderIndex;
+         index = orderPool_[index].userNext) {
+      const OrderRecord &record = orderPool_[index];
+      orders.push_back({record.id, record.timestamp, record.price,
+                        record.volume, record.reserve, record.peak,
+                        record.stopPrice, record.instrument,
+                        record.quotedInstrument, record.type, record.kind,
+                        record.timeInForce});
+    }
+    usersState.push_back({{"name", user.name},
+                          {"balance", user.balance},
+                          {"reserved", user.reserved},
+                          {"openNotional", user.openNotional},
+                          {"orders", std::move(orders)}});
+  }
+  nlohmann::json &booksState = snapshot["books"];
+  booksState = nlohmann::json::array();
+  for (const OrderBook &orderBook : orderBooks_) {
+    // Объём уровня сохраняется как есть: пересчёт суммированием дал бы
+    // другое округление.
+    const auto saveLevels = [this](const auto &levels) {
+      nlohmann::json levelsState = nlohmann::json::array();
+      for (const auto &levelPair : levels) {
+        nlohmann::json ids = nlohmann::json::array();
+        for (std::uint32_t index = levelPair.second.head;
+             index != nullOrderIndex; index = orderPool_[index].levelNext) {
+          ids.push_back(orderPool_[index].id);
+        }
+        levelsState.push_back({levelPair.second.volume, std::move(ids)});
+      }
+      return levelsState;
+    };
+    const auto saveStops = [this](const auto &stops) {
+      nlohmann::json ids = nlohmann::json::array();
+      for (const auto &stopPair : stops) {
+        ids.push_back(orderPool_[stopPair.second].id);
+      }
+      return ids;
+    };
+    booksState.push_back({{"lastPrice", orderBook.lastPrice},
+                          {"buy", saveLevels(orderBook.toBuy)},
+                          {"sell", saveLevels(orderBook.toSell)},
+                          {"buyStops", saveStops(orderBook.buyStops)},
+                          {"sellStops", saveStops(orderBook.sellStops)}});
+  }
+  nlohmann::json &expiriesState = snapshot["expiries"];
+  expiriesState = nlohmann::json::array();
+  expiries_.forEach([this, &expiriesState](std::int64_t expireTime,
+                                           const Expiry &expiry) {
+    // Таймеры отменённых заявок не сохраняются.
+    if (orderPool_[expiry.index].id == expiry.id) {
+      expiriesState.push_back({expireTime, expiry.id});
+    }
+  });
+  return snapshot;
+}
+
+void TradingExchangeClient::loadSnapshot(const nlohmann::json &snapshot,
+                                         std::int64_t timestamp) {
+  lastOrderId_ = snapshot.at("lastOrderId").get<std::uint64_t>();
+  externalBalance_ = snapshot.at("externalBalance").get<common::Balance>();
+  // Индекс записи в пуле по номеру заявки.
+  std::unordered_map<std::uint64_t, std::uint32_t> indices;
+  for (const nlohmann::json &userState : snapshot.at("users")) {
+    const std::uint32_t userIndex = static_cast<std::uint32_t>(users.size());
+    User &user = users.emplace_back();
+    userViews_.emplace_back();
+    user.name = userState.at("name").get<std::string>();
+    user.balance = userState.at("balance").get<common::Balance>();
+    user.reserved = userState.at("reserved").get<common::Balance>();
+    user.openNotional = userState.at("openNotional").get<float>();
+    for (const nlohmann::json &orderState : userState.at("orders")) {
+      const std::uint32_t index = orderPool_.allocate();
+      OrderRecord &record = orderPool_[index];
+      record.id = orderState.at(0).get<std::uint64_t>();
+      record.timestamp = orderState.at(1).get<std::int64_t>();
+      record.price = orderState.at(2).get<float>();
+      record.volume = orderState.at(3).get<float>();
+      record.reserve = orderState.at(4).get<float>();
+      record.peak = orderState.at(5).get<float>();
+      record.stopPrice = orderState.at(6).get<float>();
+      record.instrument =
+          orderState.at(7).get<common::currency::InstrumentId>();
+      record.quotedInstrument =
+          orderState.at(8).get<common::currency::InstrumentId>();
+      record.type = orderState.at(9).get<std::uint8_t>();
+      record.kind = orderState.at(10).get<std::uint8_t>();
+      record.timeInForce = orderState.at(11).get<std::uint8_t>();
+      record.userIndex = userIndex;
+      record.userPrev = user.ordersTail;
+      if (user.ordersTail == nullOrderIndex) {
+        user.ordersHead = index;
+      } else {
+        orderPool_[user.ordersTail].userNext = index;
+      }
+      user.ordersTail = index;
+      ++user.ordersCount;
+      indices.emplace(record.id, index);
+    }
+    userViews_[userIndex].invalidateBalance();
+  }
+  const nlohmann::json &booksState = snapshot.at("books");
+  for (std::size_t instrument = 0; instrument < orderBooks_.size();
+       ++instrument) {
+    const nlohmann::json &bookState = booksState.at(instrument);
+    OrderBook &orderBook = orderBooks_[instrument];
+    orderBook.lastPrice = bookState.at("lastPrice").get<float>();
+    const auto loadLevels = [this, &indices](const nlohmann::json &levels,
+                                             auto &orderBookLevels) {
+      for (const nlohmann::json &level : levels) {
+        std::uint32_t index = nullOrderIndex;
+        for (const nlohmann::json &id : level.at(1)) {
+          index = indices.at(id.get<std::uint64_t>());
+          linkToLevel(index);
+        }
+        if (index != nullOrderIndex) {
+          orderBookLevels[orderPool_[index].price].volume =
+              level.at(0).get<float>();
+        }
+      }
+    };
+    loadLevels(bookState.at("buy"), orderBook.toBuy);
+    loadLevels(bookState.at("sell"), orderBook.toSell);
+    const auto loadStops = [this, &indices](const nlohmann::json &ids,
+                                            auto &stops) {
+      // Заявки с одинаковой ценой срабатывания сохраняют порядок.
+      for (const nlohmann::json &id : ids) {
+        const std::uint32_t index = indices.at(id.get<std::uint64_t>());
+        stops.emplace(orderPool_[index].stopPrice, index);
+      }
+    };
+    loadStops(bookState.at("buyStops"), orderBook.buyStops);
+    loadStops(bookState.at("sellStops"), orderBook.sellStops);
+  }
+  for (const nlohmann::json &expiry : snapshot.at("expiries")) {
+    const std::uint64_t id = expiry.at(1).get<std::uint64_t>();
+    expiries_.schedule(expiry.at(0).get<std::int64_t>(), timestamp,
+                       Expiry{indices.at(id), id});
+  }
+}
+
+common::Order TradingExchangeClient::toOrder(const OrderRecord &record) {
+  common::Order order;
+  order.userID = record.userIndex;
+  order.instrument = record.quotedInstrument;
+  order.kind = static_cast<common::OrderKind>(record.kind);
+  order.timeInForce = static_cast<common::TimeInForce>(record.timeInForce);
+  if (record.quotedInstrument == record.instrument) {
+    order.volume = record.volume + record.reserve;
+    order.price = record.price;
+    order.type = static_cast<common::OrderType>(record.type);
+    order.stopPrice = record.stopPrice;
+    order.peak = record.peak;
+  } else {
+    order.volume = (record.volume + record.reserve) * record.price;
+    order.price = 1.f / record.price;
+    order.type = static_cast<common::OrderType>(oppositeType(record.type));
+    order.stopPrice = record.stopPrice > 0.f ? 1.f / record.stopPrice : 0.f;
+    order.peak = record.peak * record.price;
+  }
+  order.id = record.id;
+  order.timestamp = record.timestamp;
+  return order;
 }
 
 std::string TradingExchangeClient::withdraw(
-    const std::string &userId,
-    const common::CurrencyTypeValue &currencyTypeValue) {
-  User user = getUserById(userId);
-  if (user.name != "Unknown User") {
-    users.find(std::stoi(userId))->second.balance[currencyTypeValue.first] -=
-        currencyTypeValue.second;
+    std::size_t userId, common::currency::CurrencyId currency, float value) {
+  if (currency >= common::currency::CurrencyCount) {
+    return "Unknown currency type";
+  }
+  if (value <= 0.f) {
+    return "Invalid value";
+  }
+  if (userId < users.size()) {
+    const User &user = users[userId];
+    if (user.balance[currency] - user.reserved[currency] < value) {
+      return "Insufficient funds";
+    }
+    changeBalance(userId, currency, -value);
+    externalBalance_[currency] -= value;
     return "Withdraw accepted";
   }
-  return user.name;
+  return User().name;
 }
 
 std::string TradingExchangeClient::deposit(
-    const std::string &userId,
-    const common::CurrencyTypeValue &currencyTypeValue) {
-  User user = getUserById(userId);
-  if (user.name != "Unknown User") {
-    users.find(std::stoi(userId))->second.balance[currencyTypeValue.first] +=
-        currencyTypeValue.second;
+    std::size_t userId, common::currency::CurrencyId currency, float value) {
+  if (currency >= common::currency::CurrencyCount) {
+    return "Unknown currency type";
+  }
+  if (value <= 0.f) {
+    return "Invalid value";
+  }
+  if (userId < users.size()) {
+    changeBalance(userId, currency, value);
+    externalBalance_[currency] += value;
     return "Deposit accepted";
   }
-  return user.name;
+  return User().name;
+}
+
+void TradingExchangeClient::changeBalance(
+    std::size_t userIndex, common::currency::CurrencyId currency, float value) {
+  users[userIndex].balance[currency] += value;
+  userViews_[userIndex].invalidateBalance();
+}
+
+std::vector<std::string>
+TradingExchangeClient::checkConsistency(bool matched) const {
+  std::vector<std::string> errors;
+  const auto fail = [&errors](const std::string &error) {
+    errors.push_back(error);
+  };
+  std::size_t bookedOrders = 0;
+  for (std::size_t id = 0; id < orderBooks_.size(); ++id) {
+    const OrderBook &orderBook = orderBooks_[id];
+    const std::string book(common::currency::instruments[id].name);
+    if ((common::currency::instruments[id].canonical != id) &&
+        (!orderBook.toBuy.empty() || !orderBook.toSell.empty() ||
+         !orderBook.buyStops.empty() || !orderBook.sellStops.empty())) {
+      fail(book + ": orders in a non-canonical book");
+    }
+    const auto checkLevels = [&](const auto &levels, std::uint8_t type) {
+      for (const auto &[price, level] : levels) {
+        const std::string where = book + " level " + std::to_string(price);
+        if (level.head == nullOrderIndex) {
+          fail(where + ": empty level");
+          continue;
+        }
+        float volume = 0.f;
+        std::uint32_t prev = nullOrderIndex;
+        for (std::uint32_t index = level.head; index != nullOrderIndex;
+             index = orderPool_[index].levelNext) {
+          const OrderRecord &record = orderPool_[index];
+          ++bookedOrders;
+          if ((record.id == 0) || (record.levelPrev != prev) ||
+              (record.price != price) || (record.type != type) ||
+              (record.instrument != id) || isPendingStop(record) ||
+              (record.volume <= 0.f) || (record.reserve < 0.f)) {
+            fail(where + ": bad order #" + std::to_string(record.id));
+          }
+          volume += record.volume;
+          prev = index;
+        }
+        if (level.tail != prev) {
+          fail(where + ": bad tail");
+        }
+        if (!nearlyEqual(volume, level.volume)) {
+          fail(where + ": volume " + std::to_string(level.volume) +
+               " != " + std::to_string(volume));
+        }
+      }
+    };
+    checkLevels(orderBook.toBuy, common::OrderType_Buy);
+    checkLevels(orderBook.toSell, common::OrderType_Sell);
+    const auto checkStops = [&](const auto &stops, std::uint8_t type) {
+      for (const auto &[stopPrice, index] : stops) {
+        const OrderRecord &record = orderPool_[index];
+        ++bookedOrders;
+        if ((record.id == 0) || !isPendingStop(record) ||
+            (record.stopPrice != stopPrice) || (record.type != type) ||
+            (record.instrument != id)) {
+          fail(book + ": bad stop order #" + std::to_string(record.id));
+        }
+      }
+    };
+    checkStops(orderBook.buyStops, common::OrderType_Buy);
+    checkStops(orderBook.sellStops, common::OrderType_Sell);
+    if (matched && !orderBook.toBuy.empty() && !orderBook.toSell.empty() &&
+        (orderBook.toBuy.begin()->first >= orderBook.toSell.begin()->first)) {
+      fail(book + ": crossed book after matching");
+    }
+  }
+
+  std::size_t userOrders = 0;
+  common::Balance totalBalance = {};
+  for (std::size_t userId = 0; userId < users.size(); ++userId) {
+    const User &user = users[userId];
+    const std::string who = "user " + std::to_string(userId);
+    common::Balance reserved = {};
+    float openNotional = 0.f;
+    std::size_t count = 0;
+    std::uint32_t prev = nullOrderIndex;
+    for (std::uint32_t index = user.ordersHead; index != nullOrderIndex;
+         index = orderPool_[index].userNext) {
+      const OrderRecord &record = orderPool_[index];
+      if ((record.userIndex != userId) || (record.userPrev != prev)) {
+        fail(who + ": bad order #" + std::to_string(record.id));
+      }
+      const float volume = record.volume + record.reserve;
+      const auto [currency, amount] =
+          requiredFunds(common::currency::instruments[record.instrument],
+                        record.type, record.price, volume);
+      reserved[currency] += amount;
+      openNotional += record.price * volume;
+      ++count;
+      prev = index;
+    }
+    userOrders += count;
+    if ((user.ordersTail != prev) || (user.ordersCount != count)) {
+      fail(who + ": bad order list");
+    }
+    if (!nearlyEqual(user.openNotional, openNotional)) {
+      fail(who + ": open notional " + std::to_string(user.openNotional) +
+           " != " + std::to_string(openNotional));
+    }
+    for (std::size_t currency = 0; currency < reserved.size(); ++currency) {
+      const std::string name(common::currency::currencyNames[currency]);
+      if (!nearlyEqual(user.reserved[currency], reserved[currency])) {
+        fail(who + ": reserved " + name + " " +
+             std::to_string(user.reserved[currency]) +
+             " != " + std::to_string(reserved[currency]));
+      }
+      if (user.balance[currency] - user.reserved[currency] < -1e-2f) {
+        fail(who + ": " + name + " reserve exceeds balance");
+      }
+      totalBalance[currency] += user.balance[currency];
+    }
+  }
+  if ((userOrders != bookedOrders) || (userOrders != orderPool_.size())) {
+    fail("orders: " + std::to_string(userOrders) + " in user lists, " +
+         std::to_string(bookedOrders) + " in books, " +
+         std::to_string(orderPool_.size()) + " in pool");
+  }
+  for (std::size_t currency = 0; currency < totalBalance.size(); ++currency) {
+    // Сделки только перемещают средства между пользователями.
+    if (!nearlyEqual(totalBalance[currency], externalBalance_[currency])) {
+      fail(std::string(common::currency::currencyNames[currency]) +
+           ": total balance " + std::to_string(totalBalance[currency]) +
+           " != deposited " + std::to_string(externalBalance_[currency]));
+    }
+  }
+  return errors;
 }
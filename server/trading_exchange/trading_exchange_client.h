@@ -1,6 +1,13 @@
 #pragma once
 
 #include "common.h"
+#include "order_pool.h"
+#include "timing_wheel.h"
+#include "trade_store.h"
+#include "tracking_allocator.h"
+#include "user_view.h"
+
+#include <functional>
 
 /**
  * @brief Клиент торговой биржи.
@@ -8,91 +15,114 @@
  * покупку/продажу и возвращает баланс пользователя.
  */
 class TradingExchangeClient {
-private:
-  /**
-   *  @brief Компаратор для заявок на покупку.
-   */
-  struct CompareBuy {
-    bool operator()(const common::Order &a, const common::Order &b) const {
-      if (a.price.second != b.price.second) {
-        return a.price.second > b.price.second;
-      }
-      return a.time > b.time;
-    }
-  };
-
+public:
   /**
-   *  @brief Компаратор для заявок на продажу.
+   * @brief Пользователь.
    */
-  struct CompareSell {
-    bool operator()(const common::Order &a, const common::Order &b) const {
-      if (a.price.second != b.price.second) {
-        return a.price.second < b.price.second;
-      }
-      return a.time > b.time;
-    }
+  struct User {
+    std::string name = "Unknown User"; //!< Имя.
+    common::Balance balance = {};      //!< Баланс.
+    //! Средства, зарезервированные под активные заявки.
+    common::Balance reserved = {};
+    //! Суммарная стоимость активных заявок.
+    float openNotional = 0.f;
+    //! Первая (самая ранняя) заявка пользователя.
+    std::uint32_t ordersHead = nullOrderIndex;
+    //! Последняя заявка пользователя.
+    std::uint32_t ordersTail = nullOrderIndex;
+    std::size_t ordersCount = 0; //!< Количество активных заявок.
   };
 
   /**
-   *  @brief Компаратор для заявок на покупку и продажу.
+   * @brief Обработка заявок в "стакане".
+   * @param timestamp Текущее время (нс с начала эпохи).
+   * @details Снимает заявки с истёкшим сроком действия и совмещает
+   * оставшиеся.
    */
-  struct Compare {
-    bool operator()(const common::Order &a, const common::Order &b) const {
-      return a.time < b.time;
-    }
-  };
+  void process(std::int64_t timestamp);
 
-public:
   /**
-   * @brief Пользователь.
+   * @brief Заранее выделить память для заявок.
+   * @param count Количество заявок.
+   * @param hugePages Выделять большими страницами.
    */
-  struct User {
-    std::string name = "Unknown User";       //!< Имя.
-    std::string userId = "Unknown User";     //!< ID.
-    common::Balance balance;                 //!< Баланс.
-    std::set<common::Order, Compare> orders; //!< Заявки.
-  };
+  void reserveOrders(std::size_t count, bool hugePages);
 
   /**
-   * @brief Обработка заявок в "стакане".
+   * @brief Совместить заявки во всех "стаканах".
+   * @param timestamp Время сделок (нс с начала эпохи).
    */
-  void process();
+  void matchOrders(std::int64_t timestamp);
 
   /**
-   * @brief Совместить заявки.
+   * @brief Получить ленту сделок.
+   * @return Лента сделок.
    */
-  void matchOrders();
+  TradeStore &getTradeStore();
 
   /**
    * @brief Зарегистрировать нового пользователя.
    * @param userName Имя пользователя.
-   * @return ID нового пользователя.
+   * @return ID нового (или уже зарегистрированного) пользователя.
+   * @details ID пользователя - индекс его учётной записи, сессия получает
+   * его при входе и передаёт в операции биржи без поиска.
    */
-  std::string registerNewUser(const std::string &userName);
+  std::size_t registerNewUser(const std::string &userName);
 
   /**
    * @brief Получить информацию о клиенте.
    * @param userId ID пользователя.
    * @return Пользователь.
    */
-  User getUserById(const std::string &userId);
+  User getUserById(std::size_t userId) const;
 
   /**
-   * @brief Получить информацию о клиенте.
+   * @brief Найти пользователя по имени.
    * @param userName Имя пользователя.
-   * @return Пользователь.
+   * @return ID пользователя или common::unknownUser.
+   */
+  std::size_t findUser(const std::string &userName) const;
+
+  /**
+   * @brief Получить активные заявки пользователя.
+   * @param userId ID пользователя.
+   * @return Заявки в порядке регистрации.
+   */
+  std::vector<common::Order> getUserOrders(std::size_t userId);
+
+  /**
+   * @brief Получить баланс пользователя в JSON.
+   * @param userId ID пользователя.
+   * @return Баланс в JSON.
    */
-  User getUserByName(const std::string &userName);
+  std::string getUserBalance(std::size_t userId);
+
+  /**
+   * @brief Записать список заявок пользователя в JSON частями.
+   * @param userId ID пользователя.
+   * @param query Параметры запроса.
+   * @param sink Получатель частей ответа.
+   */
+  void writeUserOrders(std::size_t userId, const OrdersQuery &query,
+                       const std::function<void(std::string)> &sink);
 
   /**
    * @brief Зарегистрировать заявку на покупку/продажу.
    * @param order Заявка.
    * @return Результат регистрации заявки.
+   * @details Перед помещением в "стакан" проверяет лимиты пользователя и
+   * достаточность свободных средств, после чего резервирует их. Присваивает
+   * заявке порядковый номер. Время регистрации (order.timestamp) задаётся
+   * сервером при получении запроса, время клиента не учитывается.
+   * Заявки IOC и FOK совмещаются сразу при регистрации, их неисполненный
+   * остаток отменяется. Перед регистрацией заявки FOK "стакан" совмещается,
+   * после чего заявка отклоняется, если встречных заявок недостаточно для
+   * исполнения всего объёма.
    */
   std::string registerOrder(const common::Order &order);
   /**
    * @brief Отменить заявку на покупку/продажу.
-   * @param order Заявка.
+   * @param order Заявка (достаточно ID пользователя и номера заявки).
    * @return Результат отмены заявки.
    */
   std::string cancelOrder(const common::Order &order);
@@ -100,26 +130,254 @@ public:
   /**
    * @brief Снять денежные средства.
    * @param userId ID пользователя.
-   * @param currencyTypeValue Тип валюты-значение.
+   * @param currency Валюта.
+   * @param value Сумма.
    * @return Результат снятия денежных средств.
+   * @details Снять можно только незарезервированные средства.
    */
-  std::string withdraw(const std::string &userId,
-                       const common::CurrencyTypeValue &currencyTypeValue);
+  std::string withdraw(std::size_t userId,
+                       common::currency::CurrencyId currency, float value);
 
   /**
    * @brief Внести денежные средства.
    * @param userId ID пользователя.
-   * @param currencyTypeValue Тмп валюты-значение.
+   * @param currency Валюта.
+   * @param value Сумма.
    * @return Результат внесения денежных средств.
    */
-  std::string deposit(const std::string &userId,
-                      const common::CurrencyTypeValue &currencyTypeValue);
+  std::string deposit(std::size_t userId, common::currency::CurrencyId currency,
+                      float value);
+
+  /**
+   * @brief Получить состояние биржи (балансы и "стаканы") в JSON.
+   * @return Состояние биржи.
+   * @details Используется для сравнения результатов воспроизведения трафика.
+   */
+  std::string dumpState();
+
+  /**
+   * @brief Сохранить полное состояние биржи.
+   * @return Снимок в JSON: пользователи с балансами, резервами и заявками,
+   * очереди уровней цены и стоп-заявки "стаканов", сроки действия заявок.
+   * @details В отличие от dumpState() снимок достаточен для восстановления
+   * биржи, которая дальше обрабатывает события так же, как исходная. Лента
+   * сделок в снимок не входит.
+   */
+  nlohmann::json saveSnapshot() const;
+
+  /**
+   * @brief Восстановить состояние биржи из снимка.
+   * @param snapshot Снимок, созданный saveSnapshot().
+   * @param timestamp Время создания снимка (нс с начала эпохи).
+   * @details Применяется к пустой бирже.
+   */
+  void loadSnapshot(const nlohmann::json &snapshot, std::int64_t timestamp);
+
+  /**
+   * @brief Проверить согласованность внутренних структур биржи.
+   * @param matched Заявки только что совмещены: "стаканы" не должны
+   * пересекаться.
+   * @return Описания найденных нарушений (пусто, если нарушений нет).
+   * @details Пересчитывает с нуля то, что биржа поддерживает инкрементально:
+   * очереди и объёмы уровней цены, индекс стоп-заявок, списки заявок и
+   * резервы пользователей, сумму балансов по каждой валюте. Используется
+   * при воспроизведении трафика для проверки оптимизаций биржи.
+   */
+  std::vector<std::string> checkConsistency(bool matched) const;
 
 private:
-  //! Пользователи биржи.
-  std::map<size_t, User> users;
-  //! Таблица заявок на покупку.
-  std::set<common::Order, CompareBuy> orderBookToBuy_;
-  //! Таблица заявок на продажу.
-  std::set<common::Order, CompareSell> orderBookToSell_;
+  /**
+   * @brief Уровень цены в "стакане".
+   * @details Очередь заявок с одинаковой ценой в порядке приоритета.
+   */
+  struct PriceLevel {
+    std::uint32_t head = nullOrderIndex; //!< Первая заявка в очереди.
+    std::uint32_t tail = nullOrderIndex; //!< Последняя заявка в очереди.
+    float volume = 0.f;                  //!< Суммарный объём уровня.
+  };
+
+  //! Распределитель памяти "стаканов".
+  template <typename T>
+  using BookAllocator = TrackingAllocator<T, MemorySubsystem_Books>;
+
+  /**
+   * @brief "Стакан" одного инструмента.
+   */
+  struct OrderBook {
+    //! Уровни заявок на покупку, лучшая (максимальная) цена первая.
+    std::map<float, PriceLevel, std::greater<float>,
+             BookAllocator<std::pair<const float, PriceLevel>>>
+        toBuy;
+    //! Уровни заявок на продажу, лучшая (минимальная) цена первая.
+    std::map<float, PriceLevel, std::less<float>,
+             BookAllocator<std::pair<const float, PriceLevel>>>
+        toSell;
+    //! Стоп-заявки на покупку по цене срабатывания, ближайшая (минимальная)
+    //! первая.
+    std::multimap<float, std::uint32_t, std::less<float>,
+                  BookAllocator<std::pair<const float, std::uint32_t>>>
+        buyStops;
+    //! Стоп-заявки на продажу по цене срабатывания, ближайшая (максимальная)
+    //! первая.
+    std::multimap<float, std::uint32_t, std::greater<float>,
+                  BookAllocator<std::pair<const float, std::uint32_t>>>
+        sellStops;
+    //! Цена последней сделки (0 - сделок ещё не было).
+    float lastPrice = 0.f;
+  };
+
+  /**
+   * @brief Совместить заявки в "стакане" инструмента.
+   * @tparam Id Инструмент, шаг цены и точность суммы берутся из реестра на
+   * этапе компиляции.
+   * @param timestamp Время сделок.
+   */
+  template <common::currency::InstrumentId Id>
+  void matchOrderBook(std::int64_t timestamp);
+
+  /**
+   * @brief Совместить заявки в "стаканах" всех инструментов.
+   * @param timestamp Время сделок.
+   */
+  template <std::size_t... Ids>
+  void matchOrderBooks(std::int64_t timestamp, std::index_sequence<Ids...>);
+
+  /**
+   * @brief Совместить заявки в "стакане" инструмента, заданного во время
+   * выполнения.
+   * @param id Инструмент.
+   * @param timestamp Время сделок.
+   */
+  template <std::size_t... Ids>
+  void matchOrderBookById(common::currency::InstrumentId id,
+                          std::int64_t timestamp, std::index_sequence<Ids...>);
+
+  /**
+   * @brief Проверить, достаточно ли встречных заявок для исполнения объёма.
+   * @param orderBook "Стакан".
+   * @param type Тип заявки.
+   * @param price Цена заявки.
+   * @param volume Объём заявки.
+   * @return true-да, false-нет.
+   * @details Суммирует объёмы уровней цены, пересекающихся с заявкой, до
+   * набора нужного объёма. Скрытый объём "айсбергов" не учитывается.
+   * "Стакан" должен быть совмещён: иначе часть встречных заявок исполнится
+   * с заявками той же стороны.
+   */
+  bool hasLiquidity(const OrderBook &orderBook, std::uint8_t type,
+                    float price, float volume) const;
+
+  /**
+   * @brief Снять заявки с истёкшим сроком действия.
+   * @param timestamp Текущее время (нс с начала эпохи).
+   */
+  void expireOrders(std::int64_t timestamp);
+
+  /**
+   * @brief Изменить баланс пользователя.
+   * @param userIndex ID пользователя.
+   * @param currency Валюта.
+   * @param value Изменение баланса.
+   */
+  void changeBalance(std::size_t userIndex,
+                     common::currency::CurrencyId currency, float value);
+
+  /**
+   * @brief Освободить средства, зарезервированные под часть заявки.
+   * @param record Запись заявки.
+   * @param volume Объём, резерв под который освобождается.
+   */
+  void releaseReserve(const OrderRecord &record, float volume);
+
+  /**
+   * @brief Поместить заявку в конец очереди уровня цены (несработавшую
+   * стоп-заявку - в индекс стоп-заявок) и в список заявок пользователя.
+   * @param index Индекс записи заявки в пуле.
+   */
+  void insertOrder(std::uint32_t index);
+
+  /**
+   * @brief Поместить заявку в конец очереди уровня цены.
+   * @param index Индекс записи заявки в пуле.
+   */
+  void linkToLevel(std::uint32_t index);
+
+  /**
+   * @brief Перенести в "стакан" стоп-заявки, цена срабатывания которых
+   * достигнута сделкой.
+   * @param orderBook "Стакан".
+   * @param tradePrice Цена сделки (0 - сделок ещё не было).
+   * @details Просматриваются только сработавшие заявки: индекс упорядочен по
+   * цене срабатывания, ближайшие к рынку заявки первые.
+   */
+  void triggerStops(OrderBook &orderBook, float tradePrice);
+
+  /**
+   * @brief Убрать заявку из "стакана" и из списка заявок пользователя и
+   * освободить запись.
+   * @param index Индекс записи заявки в пуле.
+   */
+  void eraseOrder(std::uint32_t index);
+
+  /**
+   * @brief Уменьшить объём заявки после сделки.
+   * @param index Индекс записи заявки в пуле.
+   * @param level Уровень цены заявки.
+   * @param volume Исполненный объём.
+   * @details Полностью исполненная заявка удаляется, опустевший уровень цены
+   * удаляется из "стакана". Исполненная видимая часть заявки "айсберг"
+   * пополняется из скрытого объёма, и заявка переходит в конец очереди уровня.
+   */
+  void fillOrder(std::uint32_t index, PriceLevel &level, float volume);
+
+  /**
+   * @brief Убрать заявку из очереди уровня цены.
+   * @param levels Уровни цен одной стороны "стакана".
+   * @param index Индекс записи заявки в пуле.
+   */
+  template <typename Levels>
+  void unlinkFromLevel(Levels &levels, std::uint32_t index);
+
+  /**
+   * @brief Убрать несработавшую стоп-заявку из индекса стоп-заявок.
+   * @param stops Стоп-заявки одной стороны "стакана".
+   * @param index Индекс записи заявки в пуле.
+   */
+  template <typename Stops>
+  void unlinkFromStops(Stops &stops, std::uint32_t index);
+
+  /**
+   * @brief Преобразовать запись заявки в заявку протокола.
+   * @param record Запись заявки.
+   * @return Заявка.
+   */
+  static common::Order toOrder(const OrderRecord &record);
+
+  /**
+   * @brief Срок действия заявки в колесе таймеров.
+   * @details Отменённая заявка из колеса не удаляется: при срабатывании
+   * таймера номер заявки сверяется с записью в пуле.
+   */
+  struct Expiry {
+    std::uint32_t index; //!< Индекс записи заявки в пуле.
+    std::uint64_t id;    //!< Номер заявки.
+  };
+
+  //! Номер последней зарегистрированной заявки.
+  std::uint64_t lastOrderId_ = 0;
+  //! Пользователи биржи, индекс - ID пользователя.
+  std::vector<User, TrackingAllocator<User, MemorySubsystem_Users>> users;
+  //! Закодированные балансы пользователей, индекс - ID пользователя.
+  std::vector<UserView, TrackingAllocator<UserView, MemorySubsystem_Users>>
+      userViews_;
+  //! Записи активных заявок.
+  OrderPool orderPool_;
+  //! "Стаканы", индекс - InstrumentId.
+  std::array<OrderBook, common::currency::InstrumentCount> orderBooks_;
+  //! Лента сделок.
+  TradeStore tradeStore_;
+  //! Сумма внесённых за вычетом снятых средств по каждой валюте.
+  common::Balance externalBalance_ = {};
+  //! Сроки действия заявок DAY и GTD, такт колеса - одна секунда.
+  TimingWheel<Expiry> expiries_{1000000000};
 };
\ No newline at end of file
@@ -0,0 +1,169 @@
+#pragma once
+
+#include "common.h"
+#include "json_writer.h"
+#include "tracking_allocator.h"
+
+/**
+ * @brief Параметры запроса списка заявок.
+ */
+struct OrdersQuery {
+  //! Постраничный ответ (иначе - полный список в прежнем формате).
+  bool paged = false;
+  //! Номер заявки, после которой начинается страница.
+  std::uint64_t cursor = 0;
+  //! Максимальное количество заявок на странице.
+  std::size_t limit = SIZE_MAX;
+  //! Инструмент (InstrumentCount - любой).
+  common::currency::InstrumentId instrument = common::currency::InstrumentCount;
+  //! Сторона (OrderType_None - любая).
+  common::OrderType side = common::OrderType_None;
+};
+
+/**
+ * @brief Кодирование данных пользователя для ответов.
+ * @details Кэширует баланс в JSON: он мал и перекодируется только после
+ * изменения. Заявки в "стакане" хранятся только записями биржи и кодируются
+ * при запросе Orders, поэтому сделки не тратят время на их кодирование.
+ */
+class UserView {
+public:
+  /**
+   * @brief Отметить, что баланс изменился.
+   */
+  void invalidateBalance() { balanceDirty_ = true; }
+
+  /**
+   * @brief Получить баланс в JSON.
+   * @param balance Текущий баланс (кодируется только после изменения).
+   * @return Баланс в JSON.
+   */
+  const TrackedString<MemorySubsystem_Users> &
+  getBalance(const common::Balance &balance) {
+    if (balanceDirty_) {
+      balanceJson_.clear();
+      JsonWriter writer(balanceJson_);
+      writer.beginObject();
+      for (std::size_t currency = 0; currency < balance.size(); ++currency) {
+        writer.key(common::currency::currencyNames[currency])
+            .number(balance[currency]);
+      }
+      writer.endObject();
+      balanceDirty_ = false;
+    }
+    return balanceJson_;
+  }
+
+  /**
+   * @brief Записать список заявок частями.
+   * @param query Параметры запроса.
+   * @param forEachOrder Обход заявок пользователя в порядке возрастания
+   * номеров: вызывает переданный обработчик для каждой заявки, пока тот
+   * возвращает true.
+   * @param sink Получатель частей ответа, вызывается для каждой части.
+   * @details Поле next постраничного ответа - номер последней заявки
+   * страницы, его передают как cursor следующего запроса (0 - страница
+   * последняя).
+   */
+  template <typename ForEachOrder, typename Sink>
+  static void writeOrders(const OrdersQuery &query,
+                          ForEachOrder &&forEachOrder, Sink &&sink) {
+    std::string chunk;
+    std::size_t count = 0;
+    std::uint64_t last = 0;
+    std::uint64_t next = 0;
+    chunk += query.paged ? "{\"orders\":[" : "{";
+    forEachOrder([&](const common::Order &order) {
+      if ((order.id <= query.cursor) ||
+          ((query.instrument != common::currency::InstrumentCount) &&
+           (order.instrument != query.instrument)) ||
+          ((query.side != common::OrderType_None) &&
+           (order.type != query.side))) {
+        return true;
+      }
+      if (count == query.limit) {
+        next = last;
+        return false;
+      }
+      ++count;
+      last = order.id;
+      if (count > 1) {
+        chunk += ',';
+      }
+      if (!query.paged) {
+        chunk += "\"" + std::to_string(count) + "\":";
+      }
+      writeOrder(chunk, order);
+      if (chunk.size() >= limits::responseChunkSize) {
+        sink(std::move(chunk));
+        chunk.clear();
+      }
+      return true;
+    });
+    if (!query.paged && (count == 0)) {
+      sink(std::string("No orders"));
+      return;
+    }
+    if (query.paged) {
+      chunk += "],\"count\":" + std::to_string(count) +
+               ",\"next\":" + std::to_string(next) + "}";
+    } else {
+      chunk += ",\"count\":" + std::to_string(count) + "}";
+    }
+    sink(std::move(chunk));
+  }
+
+private:
+  /**
+   * @brief Закодировать заявку.
+   * @param out Строка, в конец которой записывается заявка.
+   * @param order Заявка.
+   */
+  static void writeOrder(std::string &out, const common::Order &order) {
+    const common::currency::Instrument &instrument =
+        common::currency::instruments[order.instrument];
+    JsonWriter writer(out);
+    writer.beginObject()
+        .key("volume")
+        .beginObject()
+        .key("currencyType")
+        .string(common::currency::currencyNames[instrument.base])
+        .key("value")
+        .number(order.volume)
+        .endObject()
+        .key("price")
+        .beginObject()
+        .key("currencyType")
+        .string(common::currency::currencyNames[instrument.quote])
+        .key("value")
+        .number(order.price)
+        .endObject()
+        .key("type")
+        .integer(order.type)
+        .key("userID")
+        .integer(order.userID)
+        // Поле time протокола - время регистрации в секундах.
+        .key("time")
+        .integer(order.timestamp / 1000000000)
+        .key("id")
+        .integer(order.id)
+        .key("timestamp")
+        .integer(order.timestamp);
+    if (order.kind != common::OrderKind_Limit) {
+      writer.key("kind")
+          .integer(order.kind)
+          .key("stopPrice")
+          .number(order.stopPrice)
+          .key("peak")
+          .number(order.peak);
+    }
+    if (order.timeInForce != common::TimeInForce_GTC) {
+      writer.key("timeInForce").integer(order.timeInForce);
+    }
+    writer.endObject();
+  }
+
+  //! Баланс в JSON.
+  TrackedString<MemorySubsystem_Users> balanceJson_;
+  bool balanceDirty_ = true; //!< Изменился ли баланс.
+};
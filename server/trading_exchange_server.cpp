@@ -1,44 +1,153 @@
 #include "trading_exchange_server.h"
+#include "global_replication_publisher.h"
+#include "global_memory_accounting.h"
 #include "global_trading_exchange_client.h"
+#include "global_traffic_capture.h"
+#include "session_pool.h"
+
+#include <future>
+
+namespace {
+
+//! Параметр сокета SO_REUSEPORT: несколько сокетов слушают один порт.
+using ReusePort =
+    boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+
+/**
+ * @brief Открыть сокет для принятия подключений.
+ * @param context io_context потока ввода-вывода.
+ * @param port Порт.
+ * @param shared Порт слушают несколько сокетов.
+ * @return Объект для принятия подключений.
+ */
+tcp::acceptor openAcceptor(boost::asio::io_context &context,
+                           unsigned short port, bool shared) {
+  const tcp::endpoint endpoint(tcp::v4(), port);
+  tcp::acceptor acceptor(context);
+  acceptor.open(endpoint.protocol());
+  acceptor.set_option(tcp::acceptor::reuse_address(true));
+  if (shared) {
+    acceptor.set_option(ReusePort(true));
+  }
+  acceptor.bind(endpoint);
+  acceptor.listen();
+  return acceptor;
+}
+
+} // namespace
 
 TradingExchangeServer::TradingExchangeServer(
-    boost::asio::io_service &io_service)
-    : io_service_(io_service),
-      acceptor_(io_service, tcp::endpoint(tcp::v4(), port)),
-      timer_(io_service, boost::asio::chrono::seconds(1)) {
-  std::cout << "TradingExchangeServer started! Listen " << port << " port"
-            << std::endl;
-
-  Session *new_session = new Session(io_service_);
-  acceptor_.async_accept(new_session->getSocket(),
-                         boost::bind(&TradingExchangeServer::handleAccept, this,
-                                     new_session,
-                                     boost::asio::placeholders::error));
+    const std::vector<boost::asio::io_context *> &contexts,
+    EngineThread &engine, const ServerConfig &config)
+    : engine_(engine),
+      timer_(engine.getContext(), boost::asio::chrono::seconds(1)) {
+  for (boost::asio::io_context *context : contexts) {
+    acceptors_.push_back(
+        openAcceptor(*context, config.port, contexts.size() > 1));
+  }
+  std::cout << "TradingExchangeServer started! Listen " << config.port
+            << " port";
+  if (acceptors_.size() > 1) {
+    std::cout << " in " << acceptors_.size() << " I/O threads";
+  }
+  std::cout << std::endl;
+  engine_.runAndWait([this, &config]() { startEngine(config); });
+  for (tcp::acceptor &acceptor : acceptors_) {
+    boost::asio::co_spawn(
+        acceptor.get_executor(),
+        [this, &acceptor, sessionPoolSize = config.sessionPoolSize,
+         hugePages = config.hugePages]() {
+          return acceptConnections(acceptor, sessionPoolSize, hugePages);
+        },
+        boost::asio::detached);
+  }
+}
 
+void TradingExchangeServer::startEngine(const ServerConfig &config) {
+  if (!config.captureFile.empty()) {
+    if (!GlobalTrafficCapture().open(config.captureFile)) {
+      throw std::runtime_error("Cannot open capture file " +
+                               config.captureFile);
+    }
+    std::cout << "Capturing traffic to " << config.captureFile << std::endl;
+  }
+  if (config.replicationPort != 0) {
+    GlobalReplicationPublisher().start(engine_.getContext(),
+                                       config.replicationPort);
+  }
+  if (!config.tradesDirectory.empty()) {
+    GlobalTradingExchangeClient().getTradeStore().open(config.tradesDirectory);
+    std::cout << "Trade tape in " << config.tradesDirectory << std::endl;
+  }
   startTimer();
 }
 
-void TradingExchangeServer::handleAccept(
-    Session *new_session, const boost::system::error_code &error) {
-  if (!error) {
-    new_session->startSession();
-    new_session = new Session(io_service_);
-    acceptor_.async_accept(new_session->getSocket(),
-                           boost::bind(&TradingExchangeServer::handleAccept,
-                                       this, new_session,
-                                       boost::asio::placeholders::error));
-  } else {
-    delete new_session;
+void TradingExchangeServer::stop() {
+  // Сокет закрывается в потоке, который принимает им подключения.
+  for (tcp::acceptor &acceptor : acceptors_) {
+    std::packaged_task<void()> task([&acceptor]() {
+      boost::system::error_code ignored;
+      acceptor.close(ignored);
+    });
+    std::future<void> closed = task.get_future();
+    boost::asio::dispatch(acceptor.get_executor(), [&task]() { task(); });
+    closed.get();
+  }
+  engine_.runAndWait([this]() {
+    timer_.cancel();
+    GlobalReplicationPublisher().stop();
+    TrafficCapture &trafficCapture = GlobalTrafficCapture();
+    if (trafficCapture.isOpen()) {
+      const std::string state = GlobalTradingExchangeClient().dumpState();
+      trafficCapture.write(capture::RecordKind_State, 0,
+                           common::currentTimestamp(), state.data(),
+                           static_cast<std::uint32_t>(state.size()));
+      trafficCapture.close();
+    }
+  });
+}
+
+boost::asio::awaitable<void>
+TradingExchangeServer::acceptConnections(tcp::acceptor &acceptor,
+                                         std::size_t sessionPoolSize,
+                                         bool hugePages) {
+  if (sessionPoolSize != 0) {
+    SessionPools::reserve(sessionPoolSize, hugePages);
+  }
+  while (acceptor.is_open()) {
+    boost::system::error_code error;
+    tcp::socket socket = co_await acceptor.async_accept(
+        boost::asio::redirect_error(boost::asio::use_awaitable, error));
+    if (!error) {
+      std::allocate_shared<Session>(SessionAllocator<Session>(),
+                                    std::move(socket), engine_)
+          ->startSession();
+    } else if (acceptor.is_open()) {
+      std::cerr << "Accept error: " << error.message() << std::endl;
+    }
   }
 }
 
 void TradingExchangeServer::startTimer() {
   timer_.async_wait(
-      boost::bind(&TradingExchangeServer::tradingExchangeProcess, this));
+      boost::bind(&TradingExchangeServer::tradingExchangeProcess, this,
+                  boost::asio::placeholders::error));
 }
 
-void TradingExchangeServer::tradingExchangeProcess() {
-  GlobalTradingExchangeClient().process();
+void TradingExchangeServer::tradingExchangeProcess(
+    const boost::system::error_code &error) {
+  if (error) {
+    return;
+  }
+  const std::int64_t timestamp = common::currentTimestamp();
+  GlobalTrafficCapture().write(capture::RecordKind_Tick, 0, timestamp);
+  GlobalTrafficCapture().flush();
+  GlobalReplicationPublisher().publish(capture::RecordKind_Tick, 0, timestamp);
+  GlobalTradingExchangeClient().process(timestamp);
+  if (timer_.expiry() >= nextMemoryReport_) {
+    std::cout << GlobalMemoryAccounting().summary() << std::endl;
+    nextMemoryReport_ = timer_.expiry() + limits::memoryReportInterval;
+  }
 
   timer_.expires_at(timer_.expiry() + boost::asio::chrono::seconds(1));
   startTimer();
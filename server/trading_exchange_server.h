@@ -1,8 +1,12 @@
 #pragma once
 
 #include "common.h"
+#include "engine_thread.h"
+#include "server_config.h"
 #include "session.h"
 
+#include <vector>
+
 /**
  * @brief Сервер торговой биржи.
  */
@@ -10,24 +14,52 @@ class TradingExchangeServer {
 public:
   /**
    * @brief Конструктор.
-   * @param io_service Сервис для сетевых операций.
+   * @param contexts io_context потоков ввода-вывода.
+   * @param engine Поток биржи.
+   * @param config Параметры запуска.
    * @details Выполняется запуск прослушивания входящих подключений и работы
-   * биржи.
+   * биржи. Каждый поток ввода-вывода принимает подключения своим сокетом,
+   * при нескольких потоках сокеты слушают общий порт (SO_REUSEPORT) и ядро
+   * распределяет подключения между ними. Запись трафика, репликация и
+   * таймер биржи работают в потоке биржи.
    */
-  TradingExchangeServer(boost::asio::io_service &io_service);
+  TradingExchangeServer(const std::vector<boost::asio::io_context *> &contexts,
+                        EngineThread &engine, const ServerConfig &config);
 
   /**
-   * @brief Обработать входящее подключение.
-   * @param new_session Сессия связи между сервером и клиентом.
-   * @param error Ошибка чтения данных.
+   * @brief Остановить сервер.
+   * @details Прекращает приём подключений и завершает запись трафика,
+   * сохраняя итоговое состояние биржи.
    */
-  void handleAccept(Session *new_session,
-                    const boost::system::error_code &error);
+  void stop();
 
 private:
-  boost::asio::io_service &io_service_; //!< Сервис для сетевых операций.
-  tcp::acceptor acceptor_; //!< Объект для принятия входящих подключений.
-  boost::asio::steady_timer timer_; //!< Таймер.
+  EngineThread &engine_;   //!< Поток биржи.
+  //! Объекты для принятия входящих подключений, по одному на поток
+  //! ввода-вывода.
+  std::vector<tcp::acceptor> acceptors_;
+  boost::asio::steady_timer timer_; //!< Таймер биржи.
+  //! Время следующей записи использования памяти в журнал.
+  std::chrono::steady_clock::time_point nextMemoryReport_;
+
+  /**
+   * @brief Открыть запись трафика, ленту сделок, запустить репликацию и
+   * таймер биржи.
+   * @param config Параметры запуска.
+   */
+  void startEngine(const ServerConfig &config);
+
+  /**
+   * @brief Принимать входящие подключения.
+   * @param acceptor Объект для принятия подключений. Сессии работают в его
+   * потоке ввода-вывода.
+   * @param sessionPoolSize Количество сессий, память для которых
+   * выделяется в потоке до приёма первого подключения.
+   * @param hugePages Выделять память сессий большими страницами.
+   */
+  boost::asio::awaitable<void> acceptConnections(tcp::acceptor &acceptor,
+                                                 std::size_t sessionPoolSize,
+                                                 bool hugePages);
 
   /**
    * @brief Запустить таймер.
@@ -36,6 +68,7 @@ private:
 
   /**
    * @brief Вызывает обработчик торговой биржи.
+   * @param error Ошибка таймера.
    */
-  void tradingExchangeProcess();
+  void tradingExchangeProcess(const boost::system::error_code &error);
 };